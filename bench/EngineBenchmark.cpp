@@ -0,0 +1,114 @@
+/**
+ * Engine benchmark. Runs `match` and `countGroups` of every case with the bit-parallel NFA and the lazy DFA forced,
+ * over generated inputs from 1 KiB to 4 MiB, and prints throughput per engine. The DFA is warmed up by a call over
+ * the same input first, as a `CMatcher` reused for many inputs would be. `CMatcher::selectEngine` relies on these
+ * numbers to choose between the two engines.
+ */
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/CRegex.h"
+
+namespace {
+
+/**
+ * @brief Case Benchmarked pattern and its input
+ */
+struct Case {
+	const char *pattern;  ///< Pattern
+	int         flags;    ///< CRegex::Flags
+	const char *alphabet; ///< Input alphabet
+	const char *suffix;   ///< Input suffix. Lets `match` inputs match
+	bool        anchored; ///< Benchmark `match` instead of `countGroups`
+};
+
+const Case s_cases[] = {
+	{ "a(b|c)*d",               CRegex::NO_FLAGS,         "abcdefgh",           "",    false },
+	{ "hello",                  CRegex::CASE_INSENSITIVE, "ehlloHELLO wrd",     "",    false },
+	{ "(a|b)*abb",              CRegex::NO_FLAGS,         "ab",                 "",    false },
+	{ "(foo|bar|baz)(qux|quux)", CRegex::NO_FLAGS,        "abfoqruxz ",         "",    false },
+	{ "(a|e|i|o|u)(b|c|d)+",    CRegex::NO_FLAGS,         "abcdefghijklmnopqrstuvwxyz", "", false },
+	{ "(a|b)*abb",              CRegex::NO_FLAGS,         "ab",                 "abb", true },
+	{ "(a|b|c|d)*(ab|cd)(a|b)", CRegex::NO_FLAGS,         "abcd",               "aba", true },
+	{ "(x|y|z)*x(y|z)(x|y|z)",  CRegex::NO_FLAGS,         "xyz",                "xyz", true },
+};
+
+const size_t s_min_bytes = 32 << 20; ///< Input per measurement
+const size_t s_min_runs = 3;         ///< Calls per measurement
+
+/**
+ * @brief throughput Measure engine throughput over the inputs. Inputs differ, so that the branch predictor doesn't
+ *        learn a short input by heart
+ *
+ * @return MiB/s
+ */
+double throughput(CMatcher &matcher, CMatcher::Engine engine, const Case &test, const std::vector<std::string> &inputs) {
+	matcher.forceEngine(engine);
+
+	size_t results = test.anchored ? matcher.match(inputs.front()) : matcher.countGroups(inputs.front());
+	size_t bytes = 0;
+	auto started = std::chrono::steady_clock::now();
+
+	for (const auto &input : inputs) {
+		results += test.anchored ? matcher.match(input) : matcher.countGroups(input);
+		bytes += input.size();
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	// Keeps the calls from being optimized out
+	if (results == static_cast<size_t>(-1)) {
+		std::cerr << results << std::endl;
+	}
+
+	return bytes / double(1 << 20) / seconds;
+}
+
+} // namespace
+
+int main()
+{
+	std::mt19937 random(1);
+	CRegex regex;
+
+	std::cout << std::left << std::setw(36) << "case" << std::right << std::setw(10) << "bytes"
+	          << std::setw(14) << "bit-parallel" << std::setw(14) << "lazy-dfa" << std::setw(8) << "dfa/bp" << std::endl;
+
+	for (const auto &test : s_cases) {
+		auto matcher = regex.compile(test.pattern, test.flags);
+		std::string alphabet{ test.alphabet };
+
+		if (!matcher.supports(CMatcher::Engine::BitParallel)) {
+			std::cerr << test.pattern << ": no bit-parallel engine" << std::endl;
+			continue;
+		}
+
+		for (size_t size = 1 << 10; size <= 4 << 20; size <<= 2) {
+			std::vector<std::string> inputs(std::max(s_min_runs, s_min_bytes / size));
+
+			for (auto &input : inputs) {
+				input.resize(size - std::char_traits<char>::length(test.suffix));
+
+				for (auto &character : input) {
+					character = alphabet[random() % alphabet.size()];
+				}
+
+				input += test.suffix;
+			}
+
+			auto bit_parallel = throughput(matcher, CMatcher::Engine::BitParallel, test, inputs);
+			auto lazy_dfa = throughput(matcher, CMatcher::Engine::LazyDFA, test, inputs);
+
+			std::cout << std::left << std::setw(36) << std::string(test.anchored ? "match " : "countGroups ") + test.pattern
+			          << std::right << std::setw(10) << size << std::fixed << std::setprecision(1)
+			          << std::setw(14) << bit_parallel << std::setw(14) << lazy_dfa
+			          << std::setprecision(2) << std::setw(8) << lazy_dfa / bit_parallel << std::endl;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,573 @@
+/**
+ * Differential fuzzing harness. Generates random patterns in the grammar `CRegex` accepts and random haystacks,
+ * runs every engine from `makeEngines()` and checks that results equal the reference engine. Patterns and haystacks
+ * mix letter cases with digits, punctuation, NUL and bytes from 0x80, and a part of cases is compiled case insensitive.
+ * Also reports inputs where any engine goes over time or memory thresholds.
+ *
+ * Known blow-ups can be excluded by operation, either `engine.operation` or just `operation` for all engines, with
+ * `--skip-op` or the PE_FUZZ_SKIP_OPS environment variable (comma separated), so the harness works as a regression
+ * gate. E.g. `--skip-op count` excludes the unbounded recursion of `CNFA::count` on nullable loops.
+ *
+ * Two modes:
+ *   - standalone randomized driver (default). Every case runs in a forked child with a timer and an address space
+ *     limit, so hangs, stack overflows and memory blow-ups are reported with the input instead of killing the run;
+ *   - libFuzzer target if built with `-DPATTERN_ENGINE_LIBFUZZER -fsanitize=fuzzer`.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "FuzzEngines.h"
+
+namespace {
+
+/**
+ * @brief ChooseFunction Source of generator decisions. Returns a value in [0, bound)
+ */
+using ChooseFunction = std::function<unsigned(unsigned bound)>;
+
+/**
+ * @brief CPatternGenerator Builds random patterns and haystacks. Decision `0` always leads to the simplest
+ *        production, so an exhausted libFuzzer input still yields a small valid pattern
+ */
+class CPatternGenerator
+{
+public:
+	explicit CPatternGenerator(ChooseFunction choose)
+		: _choose(std::move(choose)) {}
+
+	std::string pattern() {
+		return alternation(0);
+	}
+
+	int flags() {
+		return _choose(4) == 3 ? CRegex::CASE_INSENSITIVE : CRegex::NO_FLAGS;
+	}
+
+	/**
+	 * @brief haystack Random haystack up to `max_length`. Every 16th haystack is repeated up to `long_length` with
+	 *        a few characters changed: long inputs wear out DFA caches, which switches `CMatcher` engines
+	 */
+	std::string haystack(unsigned max_length, unsigned long_length) {
+		// Letters, which case insensitive patterns fold, and bytes they don't: digits, punctuation, NUL, Latin-1 letters
+		static const std::string s_alphabet{ "abcdABCD1-.\0\xe9\xc9", 14 };
+
+		std::string result(1 + _choose(max_length), 'a');
+
+		for (auto &character : result) {
+			character = s_alphabet[_choose(static_cast<unsigned>(s_alphabet.size()))];
+		}
+
+		if (long_length > result.size() && _choose(16) == 15) {
+			while (result.size() < long_length) {
+				result += result;
+			}
+
+			result.resize(long_length);
+
+			for (unsigned changes = _choose(8); changes; --changes) {
+				result[_choose(long_length)] = s_alphabet[_choose(static_cast<unsigned>(s_alphabet.size()))];
+			}
+		}
+
+		return result;
+	}
+
+private:
+	std::string alternation(unsigned depth) {
+		std::string result = concatenation(depth);
+
+		for (unsigned alternatives = _choose(3); alternatives; --alternatives) {
+			result += '|' + concatenation(depth);
+		}
+
+		return result;
+	}
+
+	std::string concatenation(unsigned depth) {
+		std::string result;
+
+		for (unsigned items = 1 + _choose(4); items; --items) {
+			result += repetition(depth);
+		}
+
+		return result;
+	}
+
+	std::string repetition(unsigned depth) {
+		std::string result = atom(depth);
+
+		switch (_choose(6)) {
+		case 1: return result + '*';
+		case 2: return result + '+';
+		case 3: return result + '?';
+		default: return result;
+		}
+	}
+
+	std::string atom(unsigned depth) {
+		static const std::string s_alphabet{ "abcAB1-\0\xe9", 9 };
+
+		if (depth < s_max_depth && _choose(4) == 3) {
+			return '(' + alternation(depth + 1) + ')';
+		}
+
+		return std::string(1, s_alphabet[_choose(static_cast<unsigned>(s_alphabet.size()))]);
+	}
+
+private:
+	static const unsigned s_max_depth = 3; ///< Maximum group nesting
+
+	ChooseFunction _choose; ///< Decision source
+};
+
+/**
+ * @brief CaseResult Outcome of a single case. Used as the child process exit code in the standalone mode
+ */
+enum CaseResult {
+	CASE_OK = 0,
+	CASE_MISMATCH = 1,
+	CASE_REJECTED = 2,    ///< Reference engine rejected the pattern. Not a failure
+	CASE_SLOW = 3,
+	CASE_OUT_OF_MEMORY = 4,
+};
+
+/**
+ * @brief OpResult Result of a single engine operation. Exceptions are a part of the result
+ */
+struct OpResult {
+	bool threw;
+	int  value;
+
+	bool operator==(const OpResult &other) const {
+		return threw == other.threw && (threw || value == other.value);
+	}
+
+	std::string toString() const {
+		return threw ? "<invalid_argument>" : std::to_string(value);
+	}
+};
+
+const unsigned s_long_haystack = 6000; ///< Default long haystack size. Enough to flush small DFA caches a few times
+
+long s_time_limit_ms = 1000;  ///< Per operation time threshold
+long s_memory_limit_mb = 1024; ///< Address space threshold for a single case
+int  s_trace_fd = -1;          ///< Pipe to the parent process. Child writes currently running operation into it
+
+std::vector<std::string> s_skip_ops; ///< Excluded operations: `engine.operation` or `operation`
+
+/**
+ * @brief addSkipOps Exclude operations from a comma separated list
+ */
+void addSkipOps(const std::string &list) {
+	size_t begin = 0;
+
+	while (begin <= list.size()) {
+		auto end = std::min(list.find(',', begin), list.size());
+
+		if (end > begin) {
+			s_skip_ops.push_back(list.substr(begin, end - begin));
+		}
+
+		begin = end + 1;
+	}
+}
+
+void addSkipOpsFromEnvironment() {
+	if (const char *list = getenv("PE_FUZZ_SKIP_OPS")) {
+		addSkipOps(list);
+	}
+}
+
+bool isSkipped(const std::string &engine, const std::string &operation) {
+	for (const auto &skip : s_skip_ops) {
+		if (skip == operation || skip == engine + "." + operation) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief quote Quote a pattern or a haystack for a report. Backslashes, quotes and bytes outside printable ASCII
+ *        are escaped as `\xHH`, which `--pattern` and `--haystack` read back
+ */
+std::string quote(const std::string &string) {
+	static const char s_digits[] = "0123456789abcdef";
+	std::string result{ "'" };
+
+	for (auto character : string) {
+		auto byte = static_cast<unsigned char>(character);
+
+		if (byte < 0x20 || byte >= 0x7f || byte == '\\' || byte == '\'') {
+			result += "\\x";
+			result += s_digits[byte >> 4];
+			result += s_digits[byte & 0xf];
+		}
+		else {
+			result += character;
+		}
+	}
+
+	return result + "'";
+}
+
+/**
+ * @brief runOp Run and time a single operation. Reports the operation to the parent process before the run,
+ *        so the parent knows who to blame if the child is killed
+ */
+OpResult runOp(const std::string &label, const std::string &pattern, int flags, const std::string &haystack,
+	           const std::function<int()> &operation) {
+	if (s_trace_fd >= 0) {
+		auto line = label + "\n";
+		(void)!write(s_trace_fd, line.data(), line.size());
+	}
+
+	OpResult result{ false, 0 };
+	auto started = std::chrono::steady_clock::now();
+
+	try {
+		result.value = operation();
+	}
+	catch (const std::invalid_argument &) {
+		result.threw = true;
+	}
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+
+	if (elapsed > s_time_limit_ms) {
+		std::cerr << "SLOW op=" << label << " ms=" << elapsed
+		          << " pattern=" << quote(pattern) << " flags=" << flags << " haystack=" << quote(haystack) << std::endl;
+
+		if (s_trace_fd >= 0) {
+			_exit(CASE_SLOW);
+		}
+
+		abort();
+	}
+
+	return result;
+}
+
+/**
+ * @brief runCase Compile the pattern by every engine and compare all operation results with the reference engine.
+ *        Operations run one by one across all engines, so a blow-up of an operation in the reference engine
+ *        doesn't hide results of cheaper operations
+ */
+CaseResult runCase(const std::string &pattern, int flags, const std::string &haystack,
+	               const std::vector<std::unique_ptr<IEngine>> &engines) {
+	std::vector<const IEngine *> applicable;
+
+	for (const auto &engine : engines) {
+		std::string name{ engine->name() };
+
+		auto compiled = runOp(name + ".compile", pattern, flags, haystack, [&]() {
+			return engine->compile(pattern, flags) ? 1 : 0;
+		});
+
+		if (compiled.threw) {
+			if (&engine == &engines.front()) {
+				return CASE_REJECTED;
+			}
+
+			std::cerr << "MISMATCH op=" << name << ".compile pattern=" << quote(pattern) << " flags=" << flags << " rejected" << std::endl;
+			return CASE_MISMATCH;
+		}
+
+		// Engine doesn't apply to the pattern
+		if (compiled.value) {
+			applicable.push_back(engine.get());
+		}
+	}
+
+	using OperationType = int (*)(const IEngine &, const std::string &);
+
+	static const std::vector<std::pair<const char *, OperationType>> s_ops = {
+		{ "match", [](const IEngine &engine, const std::string &source) { return engine.match(source) ? 1 : 0; } },
+		{ "countGroups", [](const IEngine &engine, const std::string &source) { return engine.countGroups(source); } },
+		{ "count", [](const IEngine &engine, const std::string &source) { return engine.count(source); } },
+	};
+
+	for (const auto &op : s_ops) {
+		OpResult reference{ false, 0 };
+		bool has_reference = false;
+
+		// The first engine running the operation is the reference for it
+		for (const auto *engine : applicable) {
+			if (isSkipped(engine->name(), op.first)) {
+				continue;
+			}
+
+			auto label = std::string(engine->name()) + "." + op.first;
+			auto result = runOp(label, pattern, flags, haystack, [&]() { return op.second(*engine, haystack); });
+
+			if (!has_reference) {
+				reference = result;
+				has_reference = true;
+			}
+			else if (!(result == reference)) {
+				std::cerr << "MISMATCH op=" << label
+				          << " pattern=" << quote(pattern) << " flags=" << flags << " haystack=" << quote(haystack)
+				          << " expected=" << reference.toString() << " got=" << result.toString() << std::endl;
+				return CASE_MISMATCH;
+			}
+		}
+	}
+
+	return CASE_OK;
+}
+
+#ifndef PATTERN_ENGINE_LIBFUZZER
+
+/**
+ * @brief runIsolated Run a case in a forked child under time and memory limits
+ *
+ * @return `true` if the case passed
+ */
+bool runIsolated(const std::string &pattern, int flags, const std::string &haystack,
+	             const std::vector<std::unique_ptr<IEngine>> &engines) {
+	int fds[2];
+
+	if (pipe(fds)) {
+		perror("pipe");
+		exit(EXIT_FAILURE);
+	}
+
+	pid_t pid = fork();
+
+	if (pid < 0) {
+		perror("fork");
+		exit(EXIT_FAILURE);
+	}
+
+	if (!pid) {
+		close(fds[0]);
+		s_trace_fd = fds[1];
+
+		rlimit memory_limit{};
+		memory_limit.rlim_cur = memory_limit.rlim_max = static_cast<rlim_t>(s_memory_limit_mb) << 20;
+		setrlimit(RLIMIT_AS, &memory_limit);
+
+		// Hard limit for the whole case. Overrun kills the child with SIGALRM
+		itimerval timer{};
+		timer.it_value.tv_sec = s_time_limit_ms * 4 / 1000;
+		timer.it_value.tv_usec = s_time_limit_ms * 4 % 1000 * 1000;
+		setitimer(ITIMER_REAL, &timer, nullptr);
+
+		try {
+			_exit(runCase(pattern, flags, haystack, engines));
+		}
+		catch (const std::bad_alloc &) {
+			_exit(CASE_OUT_OF_MEMORY);
+		}
+	}
+
+	close(fds[1]);
+
+	std::string trace;
+	char buffer[4096];
+
+	for (ssize_t size; (size = read(fds[0], buffer, sizeof(buffer))) > 0;) {
+		trace.append(buffer, static_cast<size_t>(size));
+	}
+
+	close(fds[0]);
+
+	int status = 0;
+	waitpid(pid, &status, 0);
+
+	// The last traced operation is the one that was running when the child stopped
+	if (!trace.empty()) {
+		trace.pop_back();
+	}
+
+	auto label = trace.substr(trace.find_last_of('\n') + 1);
+	auto where = " op=" + label + " pattern=" + quote(pattern) + " flags=" + std::to_string(flags) + " haystack=" + quote(haystack);
+
+	if (WIFSIGNALED(status)) {
+		if (WTERMSIG(status) == SIGALRM) {
+			std::cerr << "TIMEOUT" << where << std::endl;
+		}
+		else {
+			std::cerr << "CRASH signal=" << WTERMSIG(status) << where << std::endl;
+		}
+
+		return false;
+	}
+
+	switch (WEXITSTATUS(status)) {
+	case CASE_OK:
+	case CASE_REJECTED:
+		return true;
+	case CASE_OUT_OF_MEMORY:
+		std::cerr << "OUT_OF_MEMORY" << where << std::endl;
+		return false;
+	default:
+		// Mismatches and slow operations are already reported by the child
+		return false;
+	}
+}
+
+/**
+ * @brief unquote Undo `quote` escapes of a command line argument
+ */
+std::string unquote(const std::string &string) {
+	std::string result;
+
+	for (size_t i = 0; i < string.size(); ++i) {
+		if (string.compare(i, 2, "\\x") == 0 && i + 4 <= string.size()) {
+			result += static_cast<char>(std::stoi(string.substr(i + 2, 2), nullptr, 16));
+			i += 3;
+		}
+		else {
+			result += string[i];
+		}
+	}
+
+	return result;
+}
+
+void usage(const char *program) {
+	std::cerr << "Usage: " << program << " [--iterations N] [--seed N] [--time-ms N] [--memory-mb N] [--max-haystack N] [--long-haystack N] [--skip-op OP]...\n"
+	          << "       " << program << " --pattern P --haystack H [--flags N] [--time-ms N] [--memory-mb N] [--skip-op OP]..." << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+#endif
+
+} // namespace
+
+#ifdef PATTERN_ENGINE_LIBFUZZER
+
+extern "C" int LLVMFuzzerInitialize(int *, char ***) {
+	addSkipOpsFromEnvironment();
+	return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	static const auto s_engines = makeEngines();
+
+	size_t offset = 0;
+	CPatternGenerator generator([&](unsigned bound) {
+		return offset < size ? data[offset++] % bound : 0;
+	});
+
+	auto flags = generator.flags();
+	auto pattern = generator.pattern();
+	auto haystack = generator.haystack(64, s_long_haystack);
+
+	if (runCase(pattern, flags, haystack, s_engines) == CASE_MISMATCH) {
+		abort();
+	}
+
+	return 0;
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+	unsigned long iterations = 10000;
+	unsigned long seed = std::random_device{}();
+	unsigned max_haystack = 32;
+	unsigned long_haystack = s_long_haystack;
+	std::string pattern;
+	std::string haystack;
+	int flags = CRegex::NO_FLAGS;
+
+	addSkipOpsFromEnvironment();
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg{ argv[i] };
+
+		if (i + 1 == argc) {
+			usage(argv[0]);
+		}
+
+		std::string value{ argv[++i] };
+
+		if (arg == "--iterations") {
+			iterations = std::stoul(value);
+		}
+		else if (arg == "--seed") {
+			seed = std::stoul(value);
+		}
+		else if (arg == "--time-ms") {
+			s_time_limit_ms = std::stol(value);
+		}
+		else if (arg == "--memory-mb") {
+			s_memory_limit_mb = std::stol(value);
+		}
+		else if (arg == "--max-haystack") {
+			max_haystack = static_cast<unsigned>(std::stoul(value));
+		}
+		else if (arg == "--long-haystack") {
+			long_haystack = static_cast<unsigned>(std::stoul(value));
+		}
+		else if (arg == "--pattern") {
+			pattern = unquote(value);
+		}
+		else if (arg == "--haystack") {
+			haystack = unquote(value);
+		}
+		else if (arg == "--skip-op") {
+			addSkipOps(value);
+		}
+		else if (arg == "--flags") {
+			flags = std::stoi(value);
+		}
+		else {
+			usage(argv[0]);
+		}
+	}
+
+	const auto engines = makeEngines();
+
+	// Reproduce a single reported case
+	if (!pattern.empty() || !haystack.empty()) {
+		if (pattern.empty() || haystack.empty()) {
+			usage(argv[0]);
+		}
+
+		exit(runIsolated(pattern, flags, haystack, engines) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	std::cout << "Seed: " << seed << ", engines: " << engines.size() << std::endl;
+
+	std::mt19937 random(static_cast<std::mt19937::result_type>(seed));
+	CPatternGenerator generator([&](unsigned bound) {
+		return std::uniform_int_distribution<unsigned>(0, bound - 1)(random);
+	});
+
+	unsigned long failures = 0;
+
+	for (unsigned long i = 0; i < iterations; ++i) {
+		auto case_flags = generator.flags();
+		auto case_pattern = generator.pattern();
+		auto case_haystack = generator.haystack(max_haystack, long_haystack);
+
+		if (!runIsolated(case_pattern, case_flags, case_haystack, engines)) {
+			++failures;
+		}
+	}
+
+	std::cout << "Cases: " << iterations << ", failures: " << failures << std::endl;
+
+	exit(failures ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+#endif
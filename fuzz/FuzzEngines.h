@@ -0,0 +1,304 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../src/CRegex.h"
+
+/**
+ * @brief IEngine A matching backend under differential test. Each engine compiles a pattern on its own
+ *        and must produce the same `match`/`count`/`countGroups` results as the reference engine
+ */
+class IEngine
+{
+public:
+	virtual ~IEngine() = default;
+
+	/**
+	 * @brief name Engine name used in reports
+	 */
+	virtual const char *name() const = 0;
+
+	/**
+	 * @brief compile Compile the pattern for subsequent calls
+	 *
+	 * @param pattern Pattern
+	 * @param flags `CRegex::Flags` of the pattern
+	 *
+	 * @return If the engine applies to the pattern
+	 * @throws std::invalid_argument exception if invalid pattern
+	 */
+	virtual bool compile(const std::string &pattern, int flags) = 0;
+
+	virtual bool match(const std::string &source) const = 0;
+	virtual int countGroups(const std::string &source) const = 0;
+	virtual int count(const std::string &source) const = 0;
+};
+
+/**
+ * @brief CNFAEngine Plain NFA simulation in `CNFA`. The reference engine keeps the alphabet uncompressed,
+ *        so byte classes are tested like any other engine
+ */
+class CNFAEngine : public IEngine
+{
+public:
+	/**
+	 * @brief CNFAEngine Constructor
+	 *
+	 * @param name Engine name
+	 * @param flags `CRegex::Flags` added to the flags of every pattern
+	 */
+	CNFAEngine(const char *name, int flags)
+		: _name(name)
+		, _flags(flags) {}
+
+	const char *name() const override {
+		return _name;
+	}
+
+	bool compile(const std::string &pattern, int flags) override {
+		CRegex regex;
+		_nfa.reset(new CNFA(regex.compile(pattern, flags | _flags).nfa()));
+		return true;
+	}
+
+	bool match(const std::string &source) const override {
+		return _nfa->match(source);
+	}
+
+	int countGroups(const std::string &source) const override {
+		return _nfa->countGroups(source);
+	}
+
+	int count(const std::string &source) const override {
+		return _nfa->count(source);
+	}
+
+private:
+	const char            *_name;  ///< Engine name
+	int                    _flags; ///< Added pattern flags
+	std::unique_ptr<CNFA>  _nfa;   ///< Compiled pattern
+};
+
+/**
+ * @brief CMatcherEngine `CMatcher` with a forced engine. `Engine::Auto` tests engine selection itself.
+ *        A small DFA cache drives automatic selection through the thrashing fallback. Engines are selected per
+ *        call, so calls may repeat: the results must not change, or the engine reports an impossible -1
+ */
+class CMatcherEngine : public IEngine
+{
+public:
+	CMatcherEngine(const char *name, CMatcher::Engine engine, size_t dfa_max_states = CLazyDFA::s_default_max_states,
+		           unsigned repeats = 1)
+		: _name(name)
+		, _engine(engine)
+		, _dfa_max_states(dfa_max_states)
+		, _repeats(repeats) {}
+
+	const char *name() const override {
+		return _name;
+	}
+
+	bool compile(const std::string &pattern, int flags) override {
+		CRegex regex;
+		auto compiled = regex.compile(pattern, flags);
+
+		// Same literal analysis as `CRegex::compile`
+		_matcher.reset(new CMatcher(compiled.nfa(), compiled.supports(CMatcher::Engine::Literal) ? pattern : std::string(), _dfa_max_states));
+
+		if (!_matcher->supports(_engine)) {
+			return false;
+		}
+
+		_matcher->forceEngine(_engine);
+		return true;
+	}
+
+	bool match(const std::string &source) const override {
+		return repeat([&]() { return _matcher->match(source) ? 1 : 0; }) != 0;
+	}
+
+	int countGroups(const std::string &source) const override {
+		return repeat([&]() { return _matcher->countGroups(source); });
+	}
+
+	int count(const std::string &source) const override {
+		return repeat([&]() { return _matcher->count(source); });
+	}
+
+private:
+	int repeat(const std::function<int()> &call) const {
+		int result = call();
+
+		for (unsigned i = 1; i < _repeats; ++i) {
+			if (call() != result) {
+				return -1;
+			}
+		}
+
+		return result;
+	}
+
+private:
+	const char                *_name;           ///< Engine name
+	CMatcher::Engine           _engine;         ///< Forced engine
+	size_t                     _dfa_max_states; ///< DFA cache size
+	unsigned                   _repeats;        ///< Calls per operation
+	std::unique_ptr<CMatcher>  _matcher;        ///< Compiled pattern
+};
+
+/**
+ * @brief CLazyDFAEngine `CLazyDFA` used directly, with a small cache to flush it all the time. Chunked engine
+ *        runs `countGroups` as two interleaved resumable scans over random chunks, so cursors get restored after
+ *        flushes, and checks the match ends the scans report. `count` goes to the NFA
+ */
+class CLazyDFAEngine : public IEngine
+{
+public:
+	CLazyDFAEngine(const char *name, size_t max_states, bool chunked)
+		: _name(name)
+		, _max_states(max_states)
+		, _chunked(chunked) {}
+
+	const char *name() const override {
+		return _name;
+	}
+
+	bool compile(const std::string &pattern, int flags) override {
+		CRegex regex;
+		_nfa.reset(new CNFA(regex.compile(pattern, flags).nfa()));
+		_match_dfa.reset(new CLazyDFA(*_nfa, CLazyDFA::Mode::Anchored, _max_states));
+		_search_dfa.reset(new CLazyDFA(*_nfa, CLazyDFA::Mode::Unanchored, _max_states));
+		return true;
+	}
+
+	bool match(const std::string &source) const override {
+		return _match_dfa->match(source);
+	}
+
+	int countGroups(const std::string &source) const override {
+		if (!_chunked) {
+			return _search_dfa->countGroups(source);
+		}
+
+		if (!source.size()) {
+			throw std::invalid_argument("Empty string");
+		}
+
+		// Chunking depends on the input only, so reported cases reproduce
+		std::minstd_rand random(static_cast<std::minstd_rand::result_type>(std::hash<std::string>()(source)));
+
+		// Two scans of the input take turns on the DFA like two streams of a scanning service worker. Flushes by
+		// one scan make the other restore its DFA state from the cursor
+		CLazyDFA::Cursor cursors[2];
+		size_t offsets[2] = { 0, 0 };
+		size_t results[2] = { 0, 0 };
+		std::vector<size_t> match_ends;
+
+		while (offsets[0] < source.size() || offsets[1] < source.size()) {
+			for (size_t i = 0; i < 2; ++i) {
+				if (offsets[i] == source.size()) {
+					continue;
+				}
+
+				auto size = std::min<size_t>(1 + random() % 8, source.size() - offsets[i]);
+				match_ends.clear();
+
+				auto matches = _search_dfa->scan(cursors[i], source.data() + offsets[i], size, &match_ends);
+
+				// Match ends are increasing chunk offsets, one per match. Report broken ones as an impossible count
+				if (matches != match_ends.size() || !std::is_sorted(match_ends.begin(), match_ends.end())
+					|| (!match_ends.empty() && (match_ends.front() == 0 || match_ends.back() > size))) {
+					return -1;
+				}
+
+				results[i] += matches;
+				offsets[i] += size;
+			}
+		}
+
+		return results[0] == results[1] ? static_cast<int>(results[0]) : -1;
+	}
+
+	int count(const std::string &source) const override {
+		return _nfa->count(source);
+	}
+
+private:
+	const char                *_name;       ///< Engine name
+	size_t                     _max_states; ///< DFA cache size
+	bool                       _chunked;    ///< If `countGroups` scans random chunks
+	std::unique_ptr<CNFA>      _nfa;        ///< Compiled pattern
+	std::unique_ptr<CLazyDFA>  _match_dfa;  ///< Anchored DFA
+	std::unique_ptr<CLazyDFA>  _search_dfa; ///< Unanchored DFA
+};
+
+/**
+ * @brief CFoldedEngine Oracle for case insensitive patterns: the reference engine over lowercased pattern
+ *        and input. Applies to case insensitive patterns only
+ */
+class CFoldedEngine : public IEngine
+{
+public:
+	const char *name() const override {
+		return "folded";
+	}
+
+	bool compile(const std::string &pattern, int flags) override {
+		if (!(flags & CRegex::CASE_INSENSITIVE)) {
+			return false;
+		}
+
+		return _reference.compile(fold(pattern), flags & ~CRegex::CASE_INSENSITIVE);
+	}
+
+	bool match(const std::string &source) const override {
+		return _reference.match(fold(source));
+	}
+
+	int countGroups(const std::string &source) const override {
+		return _reference.countGroups(fold(source));
+	}
+
+	int count(const std::string &source) const override {
+		return _reference.count(fold(source));
+	}
+
+private:
+	static std::string fold(std::string string) {
+		// `CRegex::CASE_INSENSITIVE` folds ASCII letters only
+		std::transform(string.begin(), string.end(), string.begin(), [](unsigned char character) {
+			return static_cast<char>(character < 0x80 ? std::tolower(character) : character);
+		});
+
+		return string;
+	}
+
+private:
+	CNFAEngine _reference{ "folded-reference", CRegex::NO_ALPHABET_COMPRESSION }; ///< Engine for folded patterns
+};
+
+/**
+ * @brief makeEngines Create all engines under test. The first one is the reference.
+ *        New backends register here
+ */
+inline std::vector<std::unique_ptr<IEngine>> makeEngines() {
+	std::vector<std::unique_ptr<IEngine>> engines;
+
+	engines.emplace_back(new CNFAEngine("nfa", CRegex::NO_ALPHABET_COMPRESSION));
+	engines.emplace_back(new CNFAEngine("nfa-byte-classes", CRegex::NO_FLAGS));
+	engines.emplace_back(new CMatcherEngine("literal", CMatcher::Engine::Literal));
+	engines.emplace_back(new CMatcherEngine("bit-parallel", CMatcher::Engine::BitParallel));
+	engines.emplace_back(new CMatcherEngine("lazy-dfa", CMatcher::Engine::LazyDFA));
+	engines.emplace_back(new CMatcherEngine("auto", CMatcher::Engine::Auto));
+	engines.emplace_back(new CMatcherEngine("auto-small-cache", CMatcher::Engine::Auto, 2, 4));
+	engines.emplace_back(new CLazyDFAEngine("lazy-dfa-small-cache", 1, false));
+	engines.emplace_back(new CLazyDFAEngine("lazy-dfa-chunks", 3, true));
+	engines.emplace_back(new CFoldedEngine());
+
+	return engines;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "CEventLoop.h"
+
+/**
+ * @brief CBufferPool Fixed ring of equally sized buffers in a single allocation. Buffers are recycled in FIFO order.
+ *        A coroutine acquiring from an empty pool suspends until a buffer is released. Loop thread only
+ */
+class CBufferPool
+{
+public:
+	/**
+	 * @brief AcquireAwaiter Resumes with a free buffer
+	 */
+	class AcquireAwaiter
+	{
+	public:
+		explicit AcquireAwaiter(CBufferPool &pool)
+			: _pool(pool)
+			, _buffer(nullptr) {}
+
+		bool await_ready() noexcept {
+			if (_pool._free.empty()) {
+				return false;
+			}
+
+			_buffer = _pool._free.front();
+			_pool._free.pop_front();
+
+			return true;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) {
+			_pool._waiters.push_back({ handle, &_buffer });
+		}
+
+		char *await_resume() const noexcept {
+			return _buffer;
+		}
+
+	private:
+		CBufferPool &_pool;   ///< Pool to acquire from
+		char        *_buffer; ///< Acquired buffer
+	};
+
+	/**
+	 * @brief CBufferPool Constructor
+	 *
+	 * @param loop Loop of the coroutines using the pool
+	 * @param count Buffer count
+	 * @param size Buffer size
+	 */
+	CBufferPool(CEventLoop &loop, size_t count, size_t size)
+		: _loop(loop)
+		, _size(size)
+		, _storage(count * size)
+		, _free()
+		, _waiters() {
+		for (size_t i = 0; i < count; ++i) {
+			_free.push_back(&_storage[i * size]);
+		}
+	}
+
+	/**
+	 * @brief bufferSize Size of every buffer
+	 */
+	size_t bufferSize() const {
+		return _size;
+	}
+
+	/**
+	 * @brief acquire Awaitable for a free buffer
+	 */
+	AcquireAwaiter acquire() {
+		return AcquireAwaiter(*this);
+	}
+
+	/**
+	 * @brief release Return the buffer to the pool. Hands it straight to the longest waiting coroutine, if any
+	 */
+	void release(char *buffer) {
+		if (_waiters.empty()) {
+			_free.push_back(buffer);
+			return;
+		}
+
+		auto waiter = _waiters.front();
+		_waiters.pop_front();
+
+		*waiter.buffer = buffer;
+		_loop.schedule(waiter.handle);
+	}
+
+private:
+	/**
+	 * @brief Waiter Coroutine suspended on an empty pool
+	 */
+	struct Waiter {
+		std::coroutine_handle<> handle; ///< Coroutine to resume
+		char                  **buffer; ///< Where to put the buffer
+	};
+
+	CEventLoop          &_loop;    ///< Loop of the coroutines using the pool
+	size_t               _size;    ///< Buffer size
+	std::vector<char>    _storage; ///< Memory of all buffers
+	std::deque<char *>   _free;    ///< Free buffers
+	std::deque<Waiter>   _waiters; ///< Coroutines waiting for a buffer
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <deque>
+#include <optional>
+
+#include "CEventLoop.h"
+
+/**
+ * @brief CChannel Bounded single-producer single-consumer queue between two coroutines of the same loop.
+ *        The producer suspends while the queue is full, the consumer suspends while it's empty
+ */
+template <typename T>
+class CChannel
+{
+public:
+	/**
+	 * @brief PushAwaiter Resumes once the value is queued
+	 */
+	class PushAwaiter
+	{
+	public:
+		PushAwaiter(CChannel &channel, T value)
+			: _channel(channel)
+			, _value(std::move(value))
+			, _suspended(false) {}
+
+		bool await_ready() {
+			if (_channel._queue.size() >= _channel._capacity) {
+				return false;
+			}
+
+			_channel.enqueue(std::move(_value));
+			return true;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) noexcept {
+			_channel._producer = handle;
+			_suspended = true;
+		}
+
+		// The consumer has freed a slot by now
+		void await_resume() {
+			if (_suspended) {
+				_channel.enqueue(std::move(_value));
+			}
+		}
+
+	private:
+		CChannel &_channel;   ///< Channel to push into
+		T         _value;     ///< Value to push
+		bool      _suspended; ///< If the queue was full
+	};
+
+	/**
+	 * @brief PopAwaiter Resumes with the next value, or empty once the channel is closed and drained
+	 */
+	class PopAwaiter
+	{
+	public:
+		explicit PopAwaiter(CChannel &channel)
+			: _channel(channel) {}
+
+		bool await_ready() const noexcept {
+			return !_channel._queue.empty() || _channel._closed;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) noexcept {
+			_channel._consumer = handle;
+		}
+
+		std::optional<T> await_resume() {
+			if (_channel._queue.empty()) {
+				return std::nullopt;
+			}
+
+			std::optional<T> value{ std::move(_channel._queue.front()) };
+			_channel._queue.pop_front();
+
+			if (_channel._producer) {
+				_channel._loop.schedule(_channel._producer);
+				_channel._producer = nullptr;
+			}
+
+			return value;
+		}
+
+	private:
+		CChannel &_channel; ///< Channel to pop from
+	};
+
+	/**
+	 * @brief CChannel Constructor
+	 *
+	 * @param loop Loop of both coroutines
+	 * @param capacity Maximum queued values
+	 */
+	CChannel(CEventLoop &loop, size_t capacity)
+		: _loop(loop)
+		, _capacity(capacity ? capacity : 1)
+		, _queue()
+		, _closed(false)
+		, _producer(nullptr)
+		, _consumer(nullptr) {}
+
+	PushAwaiter push(T value) {
+		return PushAwaiter(*this, std::move(value));
+	}
+
+	PopAwaiter pop() {
+		return PopAwaiter(*this);
+	}
+
+	/**
+	 * @brief close No more values. The consumer drains the queue and gets empty result
+	 */
+	void close() {
+		_closed = true;
+		wakeConsumer();
+	}
+
+private:
+	void enqueue(T value) {
+		_queue.push_back(std::move(value));
+		wakeConsumer();
+	}
+
+	void wakeConsumer() {
+		if (_consumer) {
+			_loop.schedule(_consumer);
+			_consumer = nullptr;
+		}
+	}
+
+private:
+	CEventLoop              &_loop;     ///< Loop of both coroutines
+	size_t                   _capacity; ///< Maximum queued values
+	std::deque<T>            _queue;    ///< Queued values
+	bool                     _closed;   ///< If the producer is done
+	std::coroutine_handle<>  _producer; ///< Producer suspended on a full queue
+	std::coroutine_handle<>  _consumer; ///< Consumer suspended on an empty queue
+};
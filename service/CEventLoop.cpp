@@ -0,0 +1,114 @@
+#include "CEventLoop.h"
+
+#include <cerrno>
+#include <system_error>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+void CEventLoop::ReadableAwaiter::await_suspend(std::coroutine_handle<> handle) {
+	epoll_event event{};
+	event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+	event.data.ptr = handle.address();
+
+	if (!epoll_ctl(_loop._epoll, EPOLL_CTL_MOD, _fd, &event)) {
+		return;
+	}
+
+	if (errno == ENOENT && !epoll_ctl(_loop._epoll, EPOLL_CTL_ADD, _fd, &event)) {
+		return;
+	}
+
+	// Descriptors epoll doesn't support (regular files) are always readable
+	_loop.schedule(handle);
+}
+
+CEventLoop::CEventLoop()
+	: _epoll(epoll_create1(EPOLL_CLOEXEC))
+	, _event_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+	, _ready()
+	, _mutex()
+	, _posted()
+	, _stopping(false) {
+	if (_epoll < 0 || _event_fd < 0) {
+		throw std::system_error(errno, std::system_category(), "Event loop creation failed");
+	}
+
+	// Null data marks the wakeup descriptor
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.ptr = nullptr;
+
+	if (epoll_ctl(_epoll, EPOLL_CTL_ADD, _event_fd, &event)) {
+		throw std::system_error(errno, std::system_category(), "Event loop creation failed");
+	}
+}
+
+CEventLoop::~CEventLoop() {
+	close(_event_fd);
+	close(_epoll);
+}
+
+void CEventLoop::run() {
+	std::vector<epoll_event> events(64);
+
+	while (!_stopping.load()) {
+		std::vector<std::function<void()>> posted;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			posted.swap(_posted);
+		}
+
+		for (const auto &function : posted) {
+			function();
+		}
+
+		// Resume only the coroutines ready before the pass. Coroutines they schedule wait for the next pass, so a
+		// stream which never blocks (a regular file) doesn't starve descriptor events, posted functions and stop
+		for (auto ready = _ready.size(); ready; --ready) {
+			auto handle = _ready.front();
+			_ready.pop_front();
+
+			handle.resume();
+		}
+
+		// Only poll if there is work left
+		int timeout = _ready.empty() ? -1 : 0;
+		int count = epoll_wait(_epoll, events.data(), static_cast<int>(events.size()), timeout);
+
+		for (int i = 0; i < count; ++i) {
+			if (events[i].data.ptr) {
+				schedule(std::coroutine_handle<>::from_address(events[i].data.ptr));
+			}
+			else {
+				uint64_t value;
+				(void)!read(_event_fd, &value, sizeof(value));
+			}
+		}
+	}
+}
+
+void CEventLoop::stop() {
+	_stopping.store(true);
+	wakeup();
+}
+
+void CEventLoop::post(std::function<void()> function) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_posted.push_back(std::move(function));
+	}
+
+	wakeup();
+}
+
+void CEventLoop::schedule(std::coroutine_handle<> handle) {
+	_ready.push_back(handle);
+}
+
+void CEventLoop::wakeup() {
+	uint64_t value{ 1 };
+	(void)!write(_event_fd, &value, sizeof(value));
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief CTask Detached coroutine. Starts eagerly and destroys its frame on completion
+ */
+struct CTask
+{
+	struct promise_type
+	{
+		CTask get_return_object() noexcept { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+
+/**
+ * @brief CEventLoop Single-threaded epoll event loop resuming coroutines. Everything except `post` and `stop`
+ *        must be called from the loop thread
+ */
+class CEventLoop
+{
+public:
+	/**
+	 * @brief ReadableAwaiter Suspends the coroutine until the file descriptor is readable
+	 */
+	class ReadableAwaiter
+	{
+	public:
+		ReadableAwaiter(CEventLoop &loop, int fd)
+			: _loop(loop)
+			, _fd(fd) {}
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<> handle);
+		void await_resume() const noexcept {}
+
+	private:
+		CEventLoop &_loop; ///< Loop to wait in
+		int         _fd;   ///< File descriptor to wait for
+	};
+
+	CEventLoop();
+	~CEventLoop();
+
+	CEventLoop(const CEventLoop &) = delete;
+	CEventLoop &operator=(const CEventLoop &) = delete;
+
+	/**
+	 * @brief run Run the loop until `stop`. Every pass resumes the coroutines scheduled before it, then polls
+	 *        descriptors
+	 */
+	void run();
+
+	/**
+	 * @brief stop Stop the loop. Thread-safe
+	 */
+	void stop();
+
+	/**
+	 * @brief post Run the function in the loop thread. Thread-safe
+	 */
+	void post(std::function<void()> function);
+
+	/**
+	 * @brief schedule Resume the coroutine on the next loop iteration
+	 */
+	void schedule(std::coroutine_handle<> handle);
+
+	/**
+	 * @brief readable Awaitable for the file descriptor readiness. Level-triggered and one-shot: every wait
+	 *        re-arms the descriptor, so the kernel doesn't wake the loop for streams nobody reads
+	 */
+	ReadableAwaiter readable(int fd) {
+		return { *this, fd };
+	}
+
+private:
+	/**
+	 * @brief wakeup Interrupt `epoll_wait`
+	 */
+	void wakeup();
+
+private:
+	int                                 _epoll;     ///< epoll instance
+	int                                 _event_fd;  ///< eventfd interrupting the loop
+	std::deque<std::coroutine_handle<>> _ready;     ///< Coroutines to resume
+	std::mutex                          _mutex;     ///< Guards `_posted`
+	std::vector<std::function<void()>>  _posted;    ///< Functions posted from other threads
+	std::atomic<bool>                   _stopping;  ///< Stop request
+};
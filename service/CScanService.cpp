@@ -0,0 +1,202 @@
+#include "CScanService.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <future>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * @brief workerNFA Copy of the pattern for a worker. Statistics are not thread-safe, so every worker has its own
+ */
+CNFA workerNFA(const CNFA &nfa) {
+	CNFA result(nfa);
+	PE_STATS(result.detachStats());
+
+	return result;
+}
+
+} // namespace
+
+/**
+ * @brief Worker Worker thread with its own loop, DFA and buffers. Streams of a worker never leave its thread
+ */
+struct CScanService::Worker
+{
+	Worker(const CNFA &pattern, const Options &options)
+		: loop()
+		, nfa(workerNFA(pattern))
+		, dfa(nfa, CLazyDFA::Mode::Unanchored)
+		, pool(loop, options.buffers_per_worker, options.buffer_size)
+		, match_ends()
+		, thread() {}
+
+	CEventLoop          loop;       ///< Event loop
+	CNFA                nfa;        ///< Worker copy of the pattern. Holds the worker statistics
+	CLazyDFA            dfa;        ///< Scanning DFA. Cache is shared by all streams of the worker
+	CBufferPool         pool;       ///< Read buffers
+	std::vector<size_t> match_ends; ///< Scratch for match offsets of a chunk
+	std::thread         thread;     ///< Thread running the loop
+};
+
+/**
+ * @brief Chunk Buffer with data read from a stream
+ */
+struct Chunk {
+	char   *data; ///< Pool buffer
+	size_t  size; ///< Bytes read
+};
+
+/**
+ * @brief Stream Scanning state of a single descriptor. Owned by its reader and scanner coroutines
+ */
+struct CScanService::Stream
+{
+	Stream(Worker &worker, int fd, size_t queue_depth)
+		: fd(fd)
+		, cursor()
+		, chunks(worker.loop, queue_depth)
+		, result{ 0, 0, 0 } {}
+
+	int               fd;     ///< Scanned descriptor
+	CLazyDFA::Cursor  cursor; ///< Scan position
+	CChannel<Chunk>   chunks; ///< Chunks from the reader to the scanner
+	StreamResult      result; ///< Stream results
+};
+
+CScanService::Options CScanService::defaultOptions() {
+	return { 0, 64 * 1024, 64, 4 };
+}
+
+CScanService::CScanService(const CNFA &nfa, const Options &options, MatchCallback on_match, CloseCallback on_close)
+	: _nfa(nfa)
+	, _options(options)
+	, _on_match(std::move(on_match))
+	, _on_close(std::move(on_close))
+	, _workers()
+	, _next_worker(0)
+	, _mutex()
+	, _closed()
+	, _open_streams(0) {
+	if (!_options.workers) {
+		_options.workers = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// Every stream needs a buffer to make progress
+	_options.buffers_per_worker = std::max<size_t>(_options.buffers_per_worker, 1);
+	_options.stream_queue_depth = std::max<size_t>(_options.stream_queue_depth, 1);
+
+	for (size_t i = 0; i < _options.workers; ++i) {
+		_workers.emplace_back(new Worker(_nfa, _options));
+	}
+
+	for (auto &worker : _workers) {
+		worker->thread = std::thread([&loop = worker->loop]() { loop.run(); });
+	}
+}
+
+CScanService::~CScanService() {
+	for (auto &worker : _workers) {
+		worker->loop.stop();
+		worker->thread.join();
+	}
+}
+
+void CScanService::add(int fd) {
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		++_open_streams;
+	}
+
+	auto &worker = *_workers[_next_worker++ % _workers.size()];
+
+	worker.loop.post([this, &worker, fd]() {
+		auto stream = std::make_shared<Stream>(worker, fd, _options.stream_queue_depth);
+
+		// Scanner goes first to wait for chunks
+		scan(worker, stream);
+		read(worker, stream);
+	});
+}
+
+void CScanService::wait() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_closed.wait(lock, [this]() { return !_open_streams; });
+}
+
+#ifdef PATTERN_ENGINE_STATS
+CStats CScanService::stats() const {
+	CStats result;
+
+	for (const auto &worker : _workers) {
+		std::promise<CStats> stats;
+		auto future = stats.get_future();
+
+		worker->loop.post([&worker, &stats]() { stats.set_value(worker->nfa.stats()); });
+		result.merge(future.get());
+	}
+
+	return result;
+}
+#endif
+
+CTask CScanService::read(Worker &worker, std::shared_ptr<Stream> stream) {
+	for (;;) {
+		char *buffer = co_await worker.pool.acquire();
+		ssize_t size = ::read(stream->fd, buffer, worker.pool.bufferSize());
+
+		if (size > 0) {
+			co_await stream->chunks.push(Chunk{ buffer, static_cast<size_t>(size) });
+			continue;
+		}
+
+		// Idle streams don't hold buffers
+		worker.pool.release(buffer);
+
+		if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+			co_await worker.loop.readable(stream->fd);
+			continue;
+		}
+
+		if (size < 0) {
+			stream->result.error = errno;
+		}
+
+		break;
+	}
+
+	stream->chunks.close();
+}
+
+CTask CScanService::scan(Worker &worker, std::shared_ptr<Stream> stream) {
+	while (auto chunk = co_await stream->chunks.pop()) {
+		auto match_ends = _on_match ? &worker.match_ends : nullptr;
+		worker.match_ends.clear();
+
+		stream->result.matches += worker.dfa.scan(stream->cursor, chunk->data, chunk->size, match_ends);
+
+		for (auto end : worker.match_ends) {
+			_on_match(stream->fd, stream->result.bytes + end);
+		}
+
+		stream->result.bytes += chunk->size;
+		worker.pool.release(chunk->data);
+	}
+
+	// The channel is closed, so the reader is done with the descriptor
+	if (_on_close) {
+		_on_close(stream->fd, stream->result);
+	}
+
+	close(stream->fd);
+
+	// Notify under the lock: the service may be destroyed as soon as `wait` returns
+	std::lock_guard<std::mutex> lock(_mutex);
+	--_open_streams;
+	_closed.notify_all();
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <thread>
+
+#include "../src/CLazyDFA.h"
+#include "CBufferPool.h"
+#include "CChannel.h"
+#include "CEventLoop.h"
+
+/**
+ * @brief CScanService Scans many file descriptors (pipes, sockets, files) for non-overlapping pattern matches,
+ *        with the same semantics as `CNFA::countGroups` over the whole stream. Worker threads each run an epoll
+ *        loop and own a DFA and a buffer pool. Every stream is a pair of coroutines on its worker:
+ *          - reader fills buffers from the pool and queues them to the scanner;
+ *          - scanner feeds the buffers through a resumable DFA scan and returns them to the pool.
+ *        A stream queues a bounded amount of buffers and a worker owns a fixed amount of them, so when scanning
+ *        falls behind reads stop, and kernel socket and pipe buffers push back to the writers.
+ *        Linux only. With PATTERN_ENGINE_STATS every worker collects statistics of its own, see `stats`
+ */
+class CScanService
+{
+public:
+	/**
+	 * @brief Options Service setup
+	 */
+	struct Options {
+		size_t workers;            ///< Worker threads. 0 means one per core
+		size_t buffer_size;        ///< Read buffer size
+		size_t buffers_per_worker; ///< Buffer pool size of every worker
+		size_t stream_queue_depth; ///< Buffers a stream may queue for scanning
+	};
+
+	/**
+	 * @brief StreamResult Per-stream results
+	 */
+	struct StreamResult {
+		uint64_t bytes;   ///< Bytes scanned
+		uint64_t matches; ///< Non-overlapping matches
+		int      error;   ///< errno of the failed read, 0 if the stream reached its end
+	};
+
+	/**
+	 * @brief MatchCallback Called for every match with the stream offset of the match end. Called from worker threads
+	 */
+	using MatchCallback = std::function<void(int fd, uint64_t match_end)>;
+
+	/**
+	 * @brief CloseCallback Called once the stream is scanned, right before its descriptor is closed. Called from worker threads
+	 */
+	using CloseCallback = std::function<void(int fd, const StreamResult &result)>;
+
+	/**
+	 * @brief defaultOptions Worker per core, 64 KiB buffers, 64 buffers per worker, 4 queued buffers per stream
+	 */
+	static Options defaultOptions();
+
+	/**
+	 * @brief CScanService Constructor. Starts worker threads
+	 *
+	 * @param nfa Compiled pattern. The service keeps a copy
+	 * @param options Service setup
+	 * @param on_match Match callback. May be empty
+	 * @param on_close Stream end callback. May be empty
+	 */
+	CScanService(const CNFA &nfa, const Options &options, MatchCallback on_match, CloseCallback on_close);
+
+	/**
+	 * @brief ~CScanService Destructor. Stops worker threads. Streams still open are abandoned, so call `wait` first
+	 */
+	~CScanService();
+
+	CScanService(const CScanService &) = delete;
+	CScanService &operator=(const CScanService &) = delete;
+
+	/**
+	 * @brief add Start scanning the descriptor. The service takes ownership and switches it to non-blocking mode.
+	 *        Thread-safe
+	 *
+	 * @param fd Descriptor to scan
+	 */
+	void add(int fd);
+
+	/**
+	 * @brief wait Block until all added streams are closed
+	 */
+	void wait();
+
+#ifdef PATTERN_ENGINE_STATS
+	/**
+	 * @brief stats Pattern statistics merged over all workers. Thread-safe: every worker copies its statistics
+	 *        in its own thread
+	 */
+	CStats stats() const;
+#endif
+
+private:
+	struct Worker;
+	struct Stream;
+
+	/**
+	 * @brief read Reader coroutine of a stream
+	 */
+	CTask read(Worker &worker, std::shared_ptr<Stream> stream);
+
+	/**
+	 * @brief scan Scanner coroutine of a stream. Closes the stream once the reader is done
+	 */
+	CTask scan(Worker &worker, std::shared_ptr<Stream> stream);
+
+private:
+	CNFA                                 _nfa;          ///< Compiled pattern
+	Options                              _options;      ///< Service setup
+	MatchCallback                        _on_match;     ///< Match callback
+	CloseCallback                        _on_close;     ///< Stream end callback
+	std::vector<std::unique_ptr<Worker>> _workers;      ///< Worker threads
+	std::atomic<size_t>                  _next_worker;  ///< Round-robin stream assignment
+	std::mutex                           _mutex;        ///< Guards `_open_streams`
+	std::condition_variable              _closed;       ///< Signals stream closes
+	size_t                               _open_streams; ///< Streams added and not closed yet
+};
@@ -0,0 +1,199 @@
+/**
+ * Local driver for `CScanService`. Writer threads push generated text through pipes and socketpairs in random-sized
+ * writes; the service scans the other ends. Per-stream match counts and match event offsets are checked against
+ * `countGroups` of an engine the service doesn't use: bit-parallel simulation if the NFA fits, NFA simulation otherwise.
+ */
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../src/CRegex.h"
+#include "CScanService.h"
+
+namespace {
+
+/**
+ * @brief Expected Stream data and what the service reported for it
+ */
+struct Expected {
+	std::string                 data;     ///< Stream content
+	std::vector<uint64_t>       events;   ///< Reported match ends
+	CScanService::StreamResult  result;   ///< Reported results
+	bool                        closed;   ///< If the stream was reported closed
+};
+
+void writeAll(int fd, const std::string &data, unsigned seed) {
+	std::mt19937 random(seed);
+	size_t offset = 0;
+
+	while (offset < data.size()) {
+		size_t size = std::min<size_t>(data.size() - offset, 1 + random() % 100000);
+		ssize_t written = write(fd, data.data() + offset, size);
+
+		if (written < 0) {
+			perror("write");
+			break;
+		}
+
+		offset += static_cast<size_t>(written);
+	}
+
+	close(fd);
+}
+
+void usage(const char *program) {
+	std::cerr << "Usage: " << program << " [--pattern P] [--streams N] [--bytes N] [--workers N] [--buffers N] [--buffer-size N]" << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	std::string pattern{ "a(b|c)*d" };
+	size_t streams = 16;
+	size_t bytes = 8 << 20;
+	auto options = CScanService::defaultOptions();
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		std::string arg{ argv[i] };
+
+		if (arg == "--pattern") {
+			pattern = argv[i + 1];
+		}
+		else if (arg == "--streams") {
+			streams = std::stoul(argv[i + 1]);
+		}
+		else if (arg == "--bytes") {
+			bytes = std::stoul(argv[i + 1]);
+		}
+		else if (arg == "--workers") {
+			options.workers = std::stoul(argv[i + 1]);
+		}
+		else if (arg == "--buffers") {
+			options.buffers_per_worker = std::stoul(argv[i + 1]);
+		}
+		else if (arg == "--buffer-size") {
+			options.buffer_size = std::stoul(argv[i + 1]);
+		}
+		else {
+			usage(argv[0]);
+		}
+	}
+
+	if (argc % 2 == 0) {
+		usage(argv[0]);
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	CRegex regex;
+	auto matcher = regex.compile(pattern);
+
+	std::mutex mutex;
+	std::map<int, Expected> expected;
+
+	CScanService service(matcher.nfa(), options,
+		[&](int fd, uint64_t match_end) {
+			std::lock_guard<std::mutex> lock(mutex);
+			expected.at(fd).events.push_back(match_end);
+		},
+		[&](int fd, const CScanService::StreamResult &result) {
+			std::lock_guard<std::mutex> lock(mutex);
+			expected.at(fd).result = result;
+			expected.at(fd).closed = true;
+		});
+
+	// Half of the streams are pipes, the other half are socketpairs. All descriptors are created before the
+	// service closes any, so descriptor numbers identify streams
+	std::mt19937 random(1);
+	std::vector<std::pair<int, int>> ends;
+
+	for (size_t i = 0; i < streams; ++i) {
+		int fds[2];
+
+		if (i % 2 ? socketpair(AF_UNIX, SOCK_STREAM, 0, fds) : pipe(fds)) {
+			perror("pipe");
+			exit(EXIT_FAILURE);
+		}
+
+		std::string data(bytes, 'a');
+
+		for (auto &character : data) {
+			character = "abcdefgh"[random() % 8];
+		}
+
+		expected[fds[0]] = Expected{ std::move(data), {}, {}, false };
+		ends.emplace_back(fds[0], fds[1]);
+	}
+
+	auto started = std::chrono::steady_clock::now();
+	std::vector<std::thread> writers;
+
+	for (size_t i = 0; i < ends.size(); ++i) {
+		service.add(ends[i].first);
+		writers.emplace_back(writeAll, ends[i].second, std::cref(expected.at(ends[i].first).data), static_cast<unsigned>(i));
+	}
+
+	service.wait();
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	for (auto &writer : writers) {
+		writer.join();
+	}
+
+	size_t failures = 0;
+	std::unique_ptr<CBitNFA> bit_nfa;
+
+	// The service scans with a lazy DFA, so the reference doesn't
+	try {
+		bit_nfa.reset(new CBitNFA(matcher.nfa()));
+	}
+	catch (const std::invalid_argument &) {
+		std::cout << "Reference: NFA simulation, the NFA is too large for bit-parallel simulation" << std::endl;
+	}
+
+	for (const auto &stream : expected) {
+		const auto &data = stream.second.data;
+		const auto &result = stream.second.result;
+
+		// Events of a stream come from a single worker in order
+		std::vector<size_t> match_ends;
+		auto matches = static_cast<uint64_t>(bit_nfa ? bit_nfa->countGroups(data, &match_ends) : matcher.nfa().countGroups(data, &match_ends));
+		bool events_match = std::equal(match_ends.begin(), match_ends.end(), stream.second.events.begin(), stream.second.events.end());
+
+		if (!stream.second.closed || result.error || result.bytes != data.size()
+			|| result.matches != matches || !events_match) {
+			std::cerr << "Stream " << stream.first << ": bytes " << result.bytes << "/" << data.size()
+			          << ", matches " << result.matches << "/" << matches
+			          << ", events " << stream.second.events.size() << (events_match ? "" : " (offsets differ)")
+			          << ", error " << result.error << std::endl;
+			++failures;
+		}
+	}
+
+#ifdef PATTERN_ENGINE_STATS
+	// Every byte is either fed into the DFA or skipped by the prefilter, in exactly one worker
+	auto stats = service.stats();
+
+	if (stats.bytes_scanned + stats.bytes_skipped != streams * bytes) {
+		std::cerr << "Statistics: " << stats.bytes_scanned << " + " << stats.bytes_skipped << " bytes, expected " << streams * bytes << std::endl;
+		++failures;
+	}
+
+	std::cout << "Statistics: " << stats.toJson() << std::endl;
+#endif
+
+	std::cout << "Streams: " << streams << ", scanned " << streams * bytes / double(1 << 20) << " MiB in " << seconds
+	          << " s (" << streams * bytes / double(1 << 20) / seconds << " MiB/s), failures: " << failures << std::endl;
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
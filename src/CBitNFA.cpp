@@ -0,0 +1,190 @@
+#include "CBitNFA.h"
+
+#include <algorithm>
+#include <bitset>
+
+const size_t CBitNFA::s_max_states;
+const size_t CBitNFA::s_chunk_bits;
+
+CBitNFA::CBitNFA(const CNFA &nfa)
+	: _char_masks(256, 0)
+	, _closures()
+	, _chunks(0)
+	, _start(0)
+	, _restart(0)
+	, _final(0)
+	, _prefilter(nfa)
+#ifdef PATTERN_ENGINE_STATS
+	, _stats(&nfa.stats())
+#endif
+	{
+	auto states = nfa.states();
+
+	if (states.size() > s_max_states) {
+		throw std::invalid_argument("Too many states for bit-parallel NFA");
+	}
+
+	// Bits are ordered by state IDs. IDs of a single pattern are consequent, but may start anywhere
+	size_t min_id = states.front()->id();
+	size_t max_id = min_id;
+
+	for (const auto &state : states) {
+		min_id = std::min(min_id, state->id());
+		max_id = std::max(max_id, state->id());
+	}
+
+	if (max_id - min_id >= s_max_states) {
+		throw std::invalid_argument("Too many states for bit-parallel NFA");
+	}
+
+	std::vector<MaskType> state_closures(max_id - min_id + 1, 0);
+	std::vector<MaskType> class_masks(nfa.classCount(), 0);
+
+	for (const auto &state : states) {
+		auto bit = state->id() - min_id;
+
+		for (const auto &trans : state->transitions()) {
+			if (trans.second->id() != state->id() + 1) {
+				throw std::invalid_argument("Character transition doesn't lead to the next state");
+			}
+
+			class_masks[trans.first] |= MaskType{ 1 } << bit;
+		}
+
+		if (state->isFinalState()) {
+			_final |= MaskType{ 1 } << bit;
+		}
+
+		// Closure of a single state. Depth-first over epsilon transitions
+		auto &closure = state_closures[bit];
+		std::vector<std::shared_ptr<CState>> stack{ state };
+
+		while (!stack.empty()) {
+			auto current = stack.back();
+			stack.pop_back();
+
+			auto current_bit = MaskType{ 1 } << (current->id() - min_id);
+
+			if (closure & current_bit) {
+				continue;
+			}
+
+			closure |= current_bit;
+
+			for (const auto &eps : current->epsilonTransitions()) {
+				stack.push_back(eps);
+			}
+		}
+	}
+
+	// Masks are built per byte class and looked up per byte: the class table costs a load per character
+	for (size_t character = 0; character < _char_masks.size(); ++character) {
+		_char_masks[character] = class_masks[nfa.byteClasses()[character]];
+	}
+
+	// Closure of a chunk value is the closure of the value without its lowest bit plus the lowest bit closure
+	_chunks = (state_closures.size() + s_chunk_bits - 1) / s_chunk_bits;
+	_closures.assign(_chunks << s_chunk_bits, 0);
+
+	for (size_t chunk = 0; chunk < _chunks; ++chunk) {
+		auto table = &_closures[chunk << s_chunk_bits];
+
+		for (size_t value = 1; value < (size_t{ 1 } << s_chunk_bits); ++value) {
+			size_t lowest = 0;
+
+			while (!(value & (size_t{ 1 } << lowest))) {
+				++lowest;
+			}
+
+			auto bit = chunk * s_chunk_bits + lowest;
+			table[value] = table[value & (value - 1)] | (bit < state_closures.size() ? state_closures[bit] : 0);
+		}
+	}
+
+	_start = state_closures[states.front()->id() - min_id];
+	_restart = MaskType{ 1 } << (states.front()->id() - min_id);
+}
+
+CBitNFA::MaskType CBitNFA::closure(MaskType states) const {
+	MaskType result{ 0 };
+
+	for (size_t chunk = 0; chunk < _chunks && states; ++chunk, states >>= s_chunk_bits) {
+		result |= _closures[(chunk << s_chunk_bits) | (states & ((1 << s_chunk_bits) - 1))];
+	}
+
+	return result;
+}
+
+bool CBitNFA::match(const std::string &source) const {
+	if (!source.size()) {
+		throw std::invalid_argument("Empty string");
+	}
+
+	PE_STATS(CStatsTimer stats_timer(*_stats));
+
+	MaskType states = _start;
+
+	for (const auto &character : source) {
+		states = closure((states & _char_masks[static_cast<unsigned char>(character)]) << 1);
+		PE_STATS(++_stats->bytes_scanned);
+		PE_STATS(_stats->recordStep(std::bitset<s_max_states>(states).count()));
+
+		// No way back from the empty set
+		if (!states) {
+			return false;
+		}
+	}
+
+	return (states & _final) != 0;
+}
+
+int CBitNFA::countGroups(const std::string &source, std::vector<size_t> *match_ends) const {
+	if (!source.size()) {
+		throw std::invalid_argument("Empty string");
+	}
+
+	PE_STATS(CStatsTimer stats_timer(*_stats));
+
+	int result{ 0 };
+	const char *data = source.data();
+	size_t size = source.size();
+
+	// Start closure is active at every position, so the set contains it unless we've just had a match
+	MaskType states = _start;
+
+	for (size_t i = 0; i < size; ++i) {
+		// Nothing in progress. Skip right to the next character which may start a match
+		if (states == _start && _prefilter.enabled()) {
+			auto next = _prefilter.find(data, i, size);
+
+			PE_STATS(_stats->bytes_skipped += next - i);
+			i = next;
+
+			if (i == size) {
+				break;
+			}
+		}
+
+		auto next_states = (states & _char_masks[static_cast<unsigned char>(data[i])]) << 1;
+
+		// Transition into a final state is a match. Start new group matching from the start state without its
+		// closure, as `CNFA::countGroups` does
+		if (next_states & _final) {
+			++result;
+
+			if (match_ends) {
+				match_ends->push_back(i + 1);
+			}
+
+			states = _restart;
+		}
+		else {
+			states = closure(next_states) | _start;
+		}
+
+		PE_STATS(++_stats->bytes_scanned);
+		PE_STATS(_stats->recordStep(std::bitset<s_max_states>(states).count()));
+	}
+
+	return result;
+}
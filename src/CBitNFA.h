@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+
+#include "CPrefilter.h"
+
+/**
+ * @brief CBitNFA Bit-parallel simulation of a small NFA. Each NFA state is a bit of a machine word, so a whole
+ *        state set advances with a few word operations per character:
+ *          - every character transition of the Thompson construction goes from state `n` to state `n + 1`,
+ *            so with bits ordered by state ID a step is `(states & char_mask[c]) << 1`;
+ *          - epsilon closure of a set is an OR of precomputed closures, looked up by 8-bit chunks of the set.
+ *        Supports NFA up to 64 states
+ */
+class CBitNFA
+{
+public:
+	/**
+	 * @brief MaskType State set type. A bit per NFA state
+	 */
+	using MaskType = uint64_t;
+
+	/**
+	 * @brief CBitNFA Constructor. Builds transition and closure tables
+	 *
+	 * @param nfa Compiled NFA. Must outlive the object
+	 * @throws std::invalid_argument exception if the NFA doesn't fit into a machine word
+	 */
+	explicit CBitNFA(const CNFA &nfa);
+
+	/**
+	 * @brief match Check if the source string matches the pattern. Same semantics as `CNFA::match`
+	 *
+	 * @param source String to match
+	 */
+	bool match(const std::string &source) const;
+
+	/**
+	 * @brief countGroups Counts non-overlapping pattern matches. Same semantics as `CNFA::countGroups`
+	 *
+	 * @param source String to match
+	 * @param match_ends If not null, receives offsets of match ends, exclusive
+	 */
+	int countGroups(const std::string &source, std::vector<size_t> *match_ends = nullptr) const;
+
+private:
+	/**
+	 * @brief closure Epsilon closure of a state set
+	 */
+	MaskType closure(MaskType states) const;
+
+private:
+	static const size_t s_max_states = 64;  ///< States fitting into MaskType
+	static const size_t s_chunk_bits = 8;   ///< Bits per closure table lookup
+
+	std::vector<MaskType> _char_masks;      ///< States having a transition for the character. Expanded from byte classes
+	std::vector<MaskType> _closures;        ///< Closures of every chunk value: [chunk][chunk value]
+	size_t                _chunks;          ///< Chunks in use
+	MaskType              _start;           ///< Start state closure
+	MaskType              _restart;         ///< Start state alone. Search restarts from it after a match
+	MaskType              _final;           ///< Final states
+	CPrefilter            _prefilter;       ///< Search prefilter
+#ifdef PATTERN_ENGINE_STATS
+	CStats               *_stats;           ///< Statistics of the NFA
+#endif
+};
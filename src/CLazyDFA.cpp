@@ -0,0 +1,353 @@
+#include "CLazyDFA.h"
+
+#include <algorithm>
+
+const size_t CLazyDFA::s_default_max_states;
+const size_t CLazyDFA::s_thrashing_flushes;
+const size_t CLazyDFA::s_min_bytes_per_state;
+const size_t CLazyDFA::s_max_retry_backoff;
+const size_t CLazyDFA::s_max_packed_row;
+const size_t CLazyDFA::s_no_row;
+
+CLazyDFA::CLazyDFA(const CNFA &nfa, Mode mode, size_t max_states)
+	: _mode(mode)
+	, _nodes()
+	, _start_set()
+	, _byte_classes(nfa.byteClasses())
+	, _class_count(nfa.classCount())
+	, _prefilter(nfa)
+	, _max_states(std::min(std::max<size_t>(max_states, 1), s_max_packed_row / _class_count))
+	, _sets()
+	, _accepting()
+	, _table()
+	, _ids()
+	, _start(-1)
+	, _dead(-1)
+	, _marks()
+	, _generation(0)
+	, _flushes(0)
+	, _flush_bytes(0)
+	, _fast_flushes(0)
+	, _retry_min(_max_states * s_min_bytes_per_state * s_thrashing_flushes)
+	, _retry_bytes(_retry_min)
+	, _skipped(0)
+#ifdef PATTERN_ENGINE_STATS
+	, _stats(&nfa.stats())
+#endif
+	{
+	auto states = nfa.states();
+	std::unordered_map<CState *, uint32_t> indices;
+
+	for (const auto &state : states) {
+		indices.emplace(state.get(), static_cast<uint32_t>(indices.size()));
+	}
+
+	for (const auto &state : states) {
+		Node node{ {}, {}, state->isFinalState() };
+
+		for (const auto &trans : state->transitions()) {
+			node.transitions.emplace_back(trans.first, indices.at(trans.second.get()));
+		}
+
+		for (const auto &eps : state->epsilonTransitions()) {
+			node.epsilons.push_back(indices.at(eps.get()));
+		}
+
+		_nodes.push_back(std::move(node));
+	}
+
+	_marks.assign(_nodes.size(), 0);
+
+	++_generation;
+	addClosure(0, _start_set);
+	std::sort(_start_set.begin(), _start_set.end());
+}
+
+void CLazyDFA::addClosure(uint32_t node, StateSet &set) {
+	std::vector<uint32_t> stack{ node };
+
+	while (!stack.empty()) {
+		auto current = stack.back();
+		stack.pop_back();
+
+		PE_STATS(++_stats->epsilon_closure_work);
+
+		if (_marks[current] == _generation) {
+			continue;
+		}
+
+		_marks[current] = _generation;
+		set.push_back(current);
+
+		for (auto eps : _nodes[current].epsilons) {
+			stack.push_back(eps);
+		}
+	}
+}
+
+int32_t CLazyDFA::addState(StateSet set) {
+	std::string key(reinterpret_cast<const char *>(set.data()), set.size() * sizeof(uint32_t));
+
+	auto found = _ids.find(key);
+
+	if (found != _ids.end()) {
+		return found->second;
+	}
+
+	if (_sets.size() >= _max_states) {
+		flush();
+	}
+
+	auto id = static_cast<int32_t>(_sets.size());
+	bool accepting = std::any_of(set.begin(), set.end(), [this](uint32_t node) { return _nodes[node].is_final; });
+
+	if (set == _start_set) {
+		_start = id;
+	}
+
+	if (set.empty()) {
+		_dead = id;
+	}
+
+	_sets.push_back(std::move(set));
+	_accepting.push_back(accepting);
+	_table.resize(_table.size() + _class_count, -1);
+	_ids.emplace(std::move(key), id);
+
+	return id;
+}
+
+int32_t CLazyDFA::startState() {
+	if (_start < 0) {
+		_start = addState(_start_set);
+	}
+
+	return _start;
+}
+
+int32_t CLazyDFA::transition(int32_t state, unsigned char byte_class) {
+	PE_STATS(++_stats->dfa_cache_misses);
+
+	if (!++_generation) {
+		std::fill(_marks.begin(), _marks.end(), 0);
+		_generation = 1;
+	}
+
+	StateSet next;
+	bool hit = false;
+
+	for (auto node : _sets[state]) {
+		for (const auto &trans : _nodes[node].transitions) {
+			if (trans.first == byte_class) {
+				hit |= _nodes[trans.second].is_final;
+				addClosure(trans.second, next);
+			}
+		}
+	}
+
+	// Search restarts from the start state without its closure after a match, as `CNFA::countGroups` does,
+	// and may start at any position otherwise
+	if (_mode == Mode::Unanchored) {
+		if (hit) {
+			next = StateSet{ 0 };
+		}
+		else {
+			addClosure(0, next);
+		}
+	}
+
+	std::sort(next.begin(), next.end());
+
+	auto flushes = _flushes;
+	auto packed = static_cast<int32_t>(row(addState(std::move(next)))) << 1 | (hit ? 1 : 0);
+
+	// Source state is gone if the cache was flushed
+	if (flushes == _flushes) {
+		_table[static_cast<size_t>(state) * _class_count + byte_class] = packed;
+	}
+
+	return packed;
+}
+
+void CLazyDFA::flush() {
+	++_flushes;
+	PE_STATS(++_stats->dfa_cache_flushes);
+
+	// The cache should last for a few scanned bytes per state. A long flush interval clears the thrashing history
+	if (_flush_bytes < _max_states * s_min_bytes_per_state) {
+		++_fast_flushes;
+	}
+	else {
+		_fast_flushes = 0;
+		_retry_bytes = _retry_min;
+	}
+
+	_flush_bytes = 0;
+
+	_sets.clear();
+	_accepting.clear();
+	_table.clear();
+	_ids.clear();
+	_start = -1;
+	_dead = -1;
+}
+
+bool CLazyDFA::isThrashing() const {
+	return _fast_flushes >= s_thrashing_flushes;
+}
+
+bool CLazyDFA::retry(size_t size) {
+	_skipped += size;
+
+	if (_skipped < _retry_bytes) {
+		return false;
+	}
+
+	_skipped = 0;
+	_fast_flushes = 0;
+	_flush_bytes = 0;
+	_retry_bytes = std::min(_retry_bytes * 2, _retry_min * s_max_retry_backoff);
+
+	return true;
+}
+
+bool CLazyDFA::match(const std::string &source) {
+	if (!source.size()) {
+		throw std::invalid_argument("Empty string");
+	}
+
+	if (_mode != Mode::Anchored) {
+		throw std::invalid_argument("Anchored DFA required");
+	}
+
+	PE_STATS(CStatsTimer stats_timer(*_stats));
+
+	auto current = row(startState());
+
+	// Hot loop state lives in locals. The table and the dead state change only when a transition is computed
+	const auto *byte_classes = _byte_classes.data();
+	const auto *table = _table.data();
+	auto class_count = _class_count;
+	auto dead = row(_dead);
+	size_t scanned = 0;
+
+	for (const auto &character : source) {
+		auto code = byte_classes[static_cast<unsigned char>(character)];
+		auto packed = table[current + code];
+
+		if (packed < 0) {
+			_flush_bytes += scanned;
+			scanned = 0;
+			packed = transition(static_cast<int32_t>(current / class_count), code);
+			table = _table.data();
+			dead = row(_dead);
+		}
+		else {
+			PE_STATS(++_stats->dfa_cache_hits);
+		}
+
+		current = static_cast<size_t>(packed >> 1);
+		++scanned;
+		PE_STATS(++_stats->bytes_scanned);
+		PE_STATS(_stats->recordStep(_sets[current / class_count].size()));
+
+		// No way back from the empty set
+		if (current == dead) {
+			_flush_bytes += scanned;
+			return false;
+		}
+	}
+
+	_flush_bytes += scanned;
+
+	return _accepting[current / class_count] != 0;
+}
+
+int CLazyDFA::countGroups(const std::string &source) {
+	if (!source.size()) {
+		throw std::invalid_argument("Empty string");
+	}
+
+	Cursor cursor;
+	return static_cast<int>(scan(cursor, source.data(), source.size()));
+}
+
+size_t CLazyDFA::scan(Cursor &cursor, const char *data, size_t size, std::vector<size_t> *match_ends) {
+	if (_mode != Mode::Unanchored) {
+		throw std::invalid_argument("Unanchored DFA required");
+	}
+
+	PE_STATS(CStatsTimer stats_timer(*_stats));
+
+	size_t result{ 0 };
+	int32_t state;
+
+	if (cursor._state < 0) {
+		state = startState();
+	}
+	else if (cursor._flushes == _flushes) {
+		state = cursor._state;
+	}
+	else {
+		state = addState(cursor._set);
+	}
+
+	// Hot loop state lives in locals. The table and the start state change only when a transition is computed
+	const auto *byte_classes = _byte_classes.data();
+	const auto *table = _table.data();
+	auto class_count = _class_count;
+	auto start = _prefilter.enabled() ? row(_start) : s_no_row;
+	auto current = row(state);
+	size_t scanned = 0;
+
+	for (size_t i = 0; i < size; ++i) {
+		// Nothing in progress. Skip right to the next character which may start a match
+		if (current == start) {
+			auto next = _prefilter.find(data, i, size);
+
+			PE_STATS(_stats->bytes_skipped += next - i);
+			i = next;
+
+			if (i == size) {
+				break;
+			}
+		}
+
+		auto code = byte_classes[static_cast<unsigned char>(data[i])];
+		auto packed = table[current + code];
+
+		if (packed < 0) {
+			_flush_bytes += scanned;
+			scanned = 0;
+			packed = transition(static_cast<int32_t>(current / class_count), code);
+			table = _table.data();
+			start = _prefilter.enabled() ? row(_start) : s_no_row;
+		}
+		else {
+			PE_STATS(++_stats->dfa_cache_hits);
+		}
+
+		current = static_cast<size_t>(packed >> 1);
+
+		if (packed & 1) {
+			++result;
+
+			if (match_ends) {
+				match_ends->push_back(i + 1);
+			}
+		}
+
+		++scanned;
+		PE_STATS(++_stats->bytes_scanned);
+		PE_STATS(_stats->recordStep(_sets[current / class_count].size()));
+	}
+
+	_flush_bytes += scanned;
+	state = static_cast<int32_t>(current / class_count);
+
+	cursor._set = _sets[state];
+	cursor._state = state;
+	cursor._flushes = _flushes;
+
+	return result;
+}
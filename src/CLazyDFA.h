@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstdint>
+
+#include "CPrefilter.h"
+
+/**
+ * @brief CLazyDFA Lazily built DFA. DFA states are NFA state sets, transitions are computed on the first use
+ *        and cached in a table with a column per byte class of the NFA. The cache is bounded: once it is full, it's flushed and refilled from scratch.
+ *        Frequent flushes mean the pattern produces too many distinct state sets for the input, in which case
+ *        callers should prefer a cheaper NFA simulation if they have one (see `isThrashing` and `retry`). Not thread-safe
+ */
+class CLazyDFA
+{
+public:
+	static const size_t s_default_max_states = 1024; ///< Default cache size
+
+	/**
+	 * @brief Mode Kind of the automaton
+	 */
+	enum class Mode {
+		Anchored,   ///< Whole string matching. Serves `match`
+		Unanchored, ///< Match search at every position. Serves `countGroups`
+	};
+
+	/**
+	 * @brief Cursor Position of a resumable unanchored scan. Belongs to a single DFA and stays valid across
+	 *        its cache flushes
+	 */
+	class Cursor
+	{
+		friend class CLazyDFA;
+
+		std::vector<uint32_t> _set;          ///< NFA state set. Restores the DFA state after a flush
+		int32_t               _state{ -1 };  ///< DFA state ID, -1 for a new scan
+		size_t                _flushes{ 0 }; ///< Flush count of the DFA when the state ID was taken
+	};
+
+	/**
+	 * @brief CLazyDFA Constructor. Copies the NFA graph into a flat representation
+	 *
+	 * @param nfa Compiled NFA
+	 * @param mode Kind of the automaton
+	 * @param max_states Cache size in DFA states
+	 */
+	CLazyDFA(const CNFA &nfa, Mode mode, size_t max_states = s_default_max_states);
+
+	/**
+	 * @brief match Check if the source string matches the pattern. Same semantics as `CNFA::match`.
+	 *        Requires Mode::Anchored
+	 *
+	 * @param source String to match
+	 */
+	bool match(const std::string &source);
+
+	/**
+	 * @brief countGroups Counts non-overlapping pattern matches. Same semantics as `CNFA::countGroups`.
+	 *        Requires Mode::Unanchored
+	 *
+	 * @param source String to match
+	 */
+	int countGroups(const std::string &source);
+
+	/**
+	 * @brief scan Resumable version of `countGroups`. Scanning a stream chunk by chunk with the same cursor gives
+	 *        the same matches as `countGroups` for the whole stream. Requires Mode::Unanchored
+	 *
+	 * @param cursor Scan position. Updated to the end of the chunk
+	 * @param data Chunk start
+	 * @param size Chunk size
+	 * @param match_ends If not null, receives offsets of match ends within the chunk, exclusive
+	 *
+	 * @return Matches in the chunk
+	 */
+	size_t scan(Cursor &cursor, const char *data, size_t size, std::vector<size_t> *match_ends = nullptr);
+
+	/**
+	 * @brief isThrashing Check if the last few cache flushes came too soon one after another. Only recent input
+	 *        counts, so a DFA that did fine for a long time still gets judged by the input it scans now
+	 */
+	bool isThrashing() const;
+
+	/**
+	 * @brief retry Account input handed to another engine because the DFA is thrashing. Once the handed off input
+	 *        outgrows the retry backoff, thrashing is reset, so the caller probes the DFA again with this input.
+	 *        The backoff doubles with every probe and drops back once the DFA scans a flush interval without thrashing
+	 *
+	 * @param size Size of the input about to be scanned
+	 *
+	 * @return If the DFA should be probed with the input
+	 */
+	bool retry(size_t size);
+
+private:
+	/**
+	 * @brief Node Flat NFA state
+	 */
+	struct Node {
+		std::vector<std::pair<unsigned char, uint32_t>> transitions; ///< Character transitions by byte class
+		std::vector<uint32_t>                           epsilons;    ///< Epsilon transitions
+		bool                                            is_final;    ///< If final state
+	};
+
+	/**
+	 * @brief StateSet Sorted NFA state indices
+	 */
+	using StateSet = std::vector<uint32_t>;
+
+	/**
+	 * @brief addClosure Add the node and its epsilon closure to the set. Nodes marked with current
+	 *        generation are already in the set
+	 */
+	void addClosure(uint32_t node, StateSet &set);
+
+	/**
+	 * @brief addState Find or create DFA state for the state set. Flushes the cache if it's full
+	 *
+	 * @return DFA state ID
+	 */
+	int32_t addState(StateSet set);
+
+	/**
+	 * @brief startState Find or create DFA state for the NFA start closure
+	 */
+	int32_t startState();
+
+	/**
+	 * @brief transition Compute and cache a DFA transition for the byte class
+	 *
+	 * @return Packed transition: table row of the next state shifted left by 1, and the lowest bit set if a character
+	 *         transition lands on a final state (used by the unanchored mode to count matches)
+	 */
+	int32_t transition(int32_t state, unsigned char byte_class);
+
+	/**
+	 * @brief row Table row offset of the state. Table entries hold rows rather than state IDs, which saves
+	 *        a multiplication per scanned byte
+	 *
+	 * @return Offset of the row, `s_no_row` for state ID -1
+	 */
+	size_t row(int32_t state) const {
+		return state < 0 ? s_no_row : static_cast<size_t>(state) * _class_count;
+	}
+
+	/**
+	 * @brief flush Drop all DFA states
+	 */
+	void flush();
+
+private:
+	static const size_t s_thrashing_flushes = 3;      ///< Consequent early flushes which mean thrashing
+	static const size_t s_min_bytes_per_state = 8;    ///< Expected scanned bytes per cached state between flushes
+	static const size_t s_max_retry_backoff = 1024;   ///< Retry backoff limit, in initial backoffs
+	static const size_t s_max_packed_row = INT32_MAX >> 1; ///< Limit of table row offsets fitting a packed transition
+	static const size_t s_no_row = SIZE_MAX;          ///< Row offset of no state
+
+	Mode                                     _mode;         ///< Kind of the automaton
+	std::vector<Node>                        _nodes;        ///< Flat NFA. Start state goes first
+	StateSet                                 _start_set;    ///< NFA start closure
+	CState::ByteClassesType                  _byte_classes; ///< Byte to byte class map of the NFA
+	size_t                                   _class_count;  ///< Transition table row width
+	CPrefilter                               _prefilter;    ///< Search prefilter
+	size_t                                   _max_states;   ///< Cache size in DFA states. Limited so that packed rows fit int32_t
+
+	std::vector<StateSet>                    _sets;         ///< NFA state sets of DFA states
+	std::vector<char>                        _accepting;    ///< If DFA state contains a final NFA state
+	std::vector<int32_t>                     _table;        ///< Packed transitions: [state][byte class], -1 if unknown
+	std::unordered_map<std::string, int32_t> _ids;          ///< DFA state IDs by raw bytes of their state sets
+	int32_t                                  _start;        ///< DFA start state ID, -1 if flushed
+	int32_t                                  _dead;         ///< DFA state ID of the empty set, -1 if not cached
+
+	std::vector<uint32_t>                    _marks;        ///< Closure generation of every node
+	uint32_t                                 _generation;   ///< Current closure generation
+
+	size_t                                   _flushes;      ///< Cache flushes over the DFA lifetime
+	size_t                                   _flush_bytes;  ///< Bytes scanned since the last flush or retry
+	size_t                                   _fast_flushes; ///< Consequent flushes after less than `s_min_bytes_per_state` per state
+	size_t                                   _retry_min;    ///< Initial retry backoff
+	size_t                                   _retry_bytes;  ///< Input to hand off before the next retry
+	size_t                                   _skipped;      ///< Input handed off since the last retry
+#ifdef PATTERN_ENGINE_STATS
+	CStats                                  *_stats;        ///< Statistics of the NFA
+#endif
+};
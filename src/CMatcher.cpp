@@ -0,0 +1,138 @@
+#include "CMatcher.h"
+
+namespace {
+
+std::shared_ptr<const CBitNFA> makeBitNFA(const CNFA &nfa) {
+	try {
+		return std::make_shared<const CBitNFA>(nfa);
+	}
+	catch (const std::invalid_argument &) {
+		return nullptr;
+	}
+}
+
+const char *engineName(CMatcher::Engine engine) {
+	switch (engine) {
+	case CMatcher::Engine::Literal: return "literal";
+	case CMatcher::Engine::BitParallel: return "bit-parallel";
+	case CMatcher::Engine::LazyDFA: return "lazy-dfa";
+	case CMatcher::Engine::NFA: return "nfa";
+	default: return "auto";
+	}
+}
+
+} // namespace
+
+CMatcher::CMatcher(const CNFA &nfa, const std::string &literal, size_t dfa_max_states)
+	: _nfa(nfa)
+	, _literal(literal)
+	, _bit_nfa(makeBitNFA(nfa))
+	, _match_dfa(nfa, CLazyDFA::Mode::Anchored, dfa_max_states)
+	, _search_dfa(nfa, CLazyDFA::Mode::Unanchored, dfa_max_states)
+	, _forced(Engine::Auto) {}
+
+CMatcher::Engine CMatcher::selectEngine(size_t source_size, CLazyDFA &dfa) {
+	if (_forced != Engine::Auto) {
+		return _forced;
+	}
+
+	if (!_literal.empty()) {
+		return Engine::Literal;
+	}
+
+	// Thrashing DFA hands input to bit-parallel simulation until it's due for another probe. Plain NFA simulation
+	// is slower than even a thrashing DFA, so without bit-parallel simulation the DFA keeps the input
+	if (_bit_nfa && dfa.isThrashing() && !dfa.retry(source_size)) {
+		return Engine::BitParallel;
+	}
+
+	return Engine::LazyDFA;
+}
+
+bool CMatcher::match(const std::string &source) {
+	switch (selectEngine(source.size(), _match_dfa)) {
+	case Engine::Literal: {
+		if (!source.size()) {
+			throw std::invalid_argument("Empty string");
+		}
+
+		PE_STATS(CStatsTimer stats_timer(_nfa.stats()));
+		PE_STATS(_nfa.stats().bytes_scanned += source.size());
+
+		return source == _literal;
+	}
+	case Engine::BitParallel:
+		return _bit_nfa->match(source);
+	case Engine::LazyDFA:
+		return _match_dfa.match(source);
+	default:
+		return _nfa.match(source);
+	}
+}
+
+int CMatcher::countGroups(const std::string &source) {
+	switch (selectEngine(source.size(), _search_dfa)) {
+	case Engine::Literal:
+		return countLiteral(source, _literal.size());
+	case Engine::BitParallel:
+		return _bit_nfa->countGroups(source);
+	case Engine::LazyDFA:
+		return _search_dfa.countGroups(source);
+	default:
+		return _nfa.countGroups(source);
+	}
+}
+
+int CMatcher::count(const std::string &source) const {
+	if (!_literal.empty() && (_forced == Engine::Auto || _forced == Engine::Literal)) {
+		return countLiteral(source, 1);
+	}
+
+	return _nfa.count(source);
+}
+
+int CMatcher::countLiteral(const std::string &source, size_t step) const {
+	if (!source.size()) {
+		throw std::invalid_argument("Empty string");
+	}
+
+	PE_STATS(CStatsTimer stats_timer(_nfa.stats()));
+	PE_STATS(_nfa.stats().bytes_scanned += source.size());
+
+	int result{ 0 };
+
+	for (auto position = source.find(_literal); position != std::string::npos; position = source.find(_literal, position + step)) {
+		++result;
+	}
+
+	return result;
+}
+
+bool CMatcher::supports(Engine engine) const {
+	switch (engine) {
+	case Engine::Literal:
+		return !_literal.empty();
+	case Engine::BitParallel:
+		return _bit_nfa != nullptr;
+	default:
+		return true;
+	}
+}
+
+void CMatcher::forceEngine(Engine engine) {
+	if (!supports(engine)) {
+		throw std::invalid_argument("Engine doesn't apply to the pattern");
+	}
+
+	_forced = engine;
+}
+
+std::string CMatcher::toJson() const {
+	return std::string{ "{\"engine\": \"" } + engineName(_forced) + "\""
+		+ ", \"literal\": " + (supports(Engine::Literal) ? "true" : "false")
+		+ ", \"bit_parallel\": " + (supports(Engine::BitParallel) ? "true" : "false")
+		+ ", \"match_dfa_thrashing\": " + (_match_dfa.isThrashing() ? "true" : "false")
+		+ ", \"search_dfa_thrashing\": " + (_search_dfa.isThrashing() ? "true" : "false")
+		+ ", \"nfa\": " + _nfa.toJson()
+		+ "}";
+}
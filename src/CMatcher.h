@@ -0,0 +1,114 @@
+#pragma once
+
+#include "CBitNFA.h"
+#include "CLazyDFA.h"
+
+/**
+ * @brief CMatcher Compiled pattern. Picks a matching engine from pattern analysis and DFA cache behaviour:
+ *   - literal pattern: substring search;
+ *   - other patterns: lazy DFA. A warm DFA is as fast as bit-parallel simulation or faster at any input size
+ *     (see `bench/EngineBenchmark.cpp`);
+ *   - lazy DFA flushing its cache too often: bit-parallel simulation for NFA up to 64 states, until enough input
+ *     went past the DFA to probe it again. NFA simulation would be slower than a thrashing DFA, so larger patterns
+ *     stay on the DFA.
+ *        `count` needs path multiplicities, which only literal search and NFA simulation track.
+ *        `match` and `countGroups` fill DFA caches, so they aren't const and a matcher must not be shared between
+ *        threads. Copies have independent caches, so every thread takes a copy
+ */
+class CMatcher
+{
+public:
+	/**
+	 * @brief Engine Matching engine
+	 */
+	enum class Engine {
+		Auto,        ///< Selected per call
+		Literal,
+		BitParallel,
+		LazyDFA,
+		NFA,
+	};
+
+	/**
+	 * @brief CMatcher Constructor. Analyzes the NFA and builds engines which apply to it
+	 *
+	 * @param nfa Compiled NFA
+	 * @param literal The pattern if it consists of plain characters only, empty string otherwise
+	 * @param dfa_max_states Cache size of the lazy DFAs in DFA states
+	 */
+	CMatcher(const CNFA &nfa, const std::string &literal, size_t dfa_max_states = CLazyDFA::s_default_max_states);
+
+	/**
+	 * @brief match Check if the source string matches the pattern. See `CNFA::match`. Fills the DFA cache
+	 *
+	 * @param source String to match
+	 */
+	bool match(const std::string &source);
+
+	/**
+	 * @brief countGroups Counts unique pattern matches in the source string. See `CNFA::countGroups`. Fills the DFA cache
+	 *
+	 * @param source String to match
+	 */
+	int countGroups(const std::string &source);
+
+	/**
+	 * @brief count Counts pattern matches in the source string, which may overlap. See `CNFA::count`
+	 *
+	 * @param source String to match
+	 */
+	int count(const std::string &source) const;
+
+	/**
+	 * @brief supports Check if the engine applies to the pattern
+	 */
+	bool supports(Engine engine) const;
+
+	/**
+	 * @brief forceEngine Use the engine for all calls instead of automatic selection. `Engine::Auto` restores
+	 *        automatic selection
+	 *
+	 * @throws std::invalid_argument exception if the engine doesn't apply to the pattern
+	 */
+	void forceEngine(Engine engine);
+
+	/**
+	 * @brief nfa Underlying NFA accessor
+	 */
+	const CNFA &nfa() const {
+		return _nfa;
+	}
+
+	/**
+	 * @brief toJson Machine-readable dump of the engine setup and the NFA
+	 *
+	 * @return JSON object
+	 */
+	std::string toJson() const;
+
+private:
+	/**
+	 * @brief selectEngine Select engine for `match` or `countGroups` call
+	 *
+	 * @param source_size Input size
+	 * @param dfa Lazy DFA which would serve the call. Accounts the input if the DFA is thrashing and bit-parallel
+	 *        simulation takes over
+	 */
+	Engine selectEngine(size_t source_size, CLazyDFA &dfa);
+
+	/**
+	 * @brief countLiteral Count literal occurrences
+	 *
+	 * @param source String to search in
+	 * @param step Offset of the next search from an occurrence. Literal size for non-overlapping matches
+	 */
+	int countLiteral(const std::string &source, size_t step) const;
+
+private:
+	CNFA                           _nfa;        ///< Compiled NFA. Reference engine
+	std::string                    _literal;    ///< Literal pattern, empty if not literal
+	std::shared_ptr<const CBitNFA> _bit_nfa;    ///< Bit-parallel engine, null if NFA is too large. Immutable, so shared between copies
+	CLazyDFA                       _match_dfa;  ///< Anchored DFA for `match`
+	CLazyDFA                       _search_dfa; ///< Unanchored DFA for `countGroups`
+	Engine                         _forced;     ///< Forced engine
+};
@@ -1,9 +1,22 @@
 #include "CNFA.h"
 
+#include <algorithm>
+#include <map>
+
 CNFA::CNFA(const std::shared_ptr<CState> &start_state, const std::shared_ptr<CState> &end_state)
 	: _start_state(start_state)
-	, _final_state(end_state) {
+	, _final_state(end_state)
+	, _byte_classes()
+	, _class_count(_byte_classes.size())
+#ifdef PATTERN_ENGINE_STATS
+	, _stats(std::make_shared<CStats>())
+#endif
+	{
 	_final_state->setIsFinalState(true);
+
+	for (size_t byte = 0; byte < _byte_classes.size(); ++byte) {
+		_byte_classes[byte] = static_cast<CState::ByteClassType>(byte);
+	}
 }
 
 CNFA::~CNFA() {
@@ -14,7 +27,9 @@ CNFA::~CNFA() {
 	}
 }
 
-void CNFA::addState(const std::shared_ptr<CState> &state, std::unordered_set<std::shared_ptr<CState>> &state_set) {
+void CNFA::addState(const std::shared_ptr<CState> &state, std::unordered_set<std::shared_ptr<CState>> &state_set) const {
+	PE_STATS(++_stats->epsilon_closure_work);
+
 	if (state_set.count(state)) {
 		return;
 	}
@@ -26,7 +41,9 @@ void CNFA::addState(const std::shared_ptr<CState> &state, std::unordered_set<std
 	}
 }
 
-void CNFA::addMultistate(const std::shared_ptr<CState> &state, std::vector<std::shared_ptr<CState>> &state_vector) {
+void CNFA::addMultistate(const std::shared_ptr<CState> &state, std::vector<std::shared_ptr<CState>> &state_vector) const {
+	PE_STATS(++_stats->epsilon_closure_work);
+
 	state_vector.push_back(state);
 
 	for (const auto &eps : state->epsilonTransitions()) {
@@ -39,23 +56,30 @@ bool CNFA::match(const std::string &source) const {
 		throw std::invalid_argument("Empty string");
 	}
 
+	PE_STATS(CStatsTimer stats_timer(*_stats));
+	PE_STATS(_stats->bytes_scanned += source.size());
+
 	// current_states contain intermediate states across all string parsing
 	std::unordered_set<std::shared_ptr<CState>> current_states;
 	addState(_start_state, current_states);
 
 	for (const auto &character : source) {
+		auto byte_class = byteClass(character);
 		std::unordered_set<std::shared_ptr<CState>> next_states;
 
 		// For each state check if it accepts the character. If so, move transition for the character into the intermediate states
 		for (const auto &state : current_states) {
-			if (state->transitions().count(character)) {
-				auto transition_state = state->transitions().at(character);
+			auto transition = state->transitions().find(byte_class);
+
+			if (transition != state->transitions().end()) {
+				const auto &transition_state = transition->second;
 
 				addState(transition_state, next_states);
 			}
 		}
 
 		current_states = next_states;
+		PE_STATS(_stats->recordStep(current_states.size()));
 	}
 
 	// Check if any of current states is a final state. If so, string fully matches the pattern
@@ -68,32 +92,42 @@ bool CNFA::match(const std::string &source) const {
 	return false;
 }
 
-int CNFA::countGroups(const std::string &source) const {
+int CNFA::countGroups(const std::string &source, std::vector<size_t> *match_ends) const {
 	if (!source.size()) {
 		throw std::invalid_argument("Empty string");
 	}
 
+	PE_STATS(CStatsTimer stats_timer(*_stats));
+	PE_STATS(_stats->bytes_scanned += source.size());
+
 	int result{ 0 };
 
 	// current_states contain intermediate states across all string parsing
 	std::unordered_set<std::shared_ptr<CState>> current_states;
 
-	for (const auto &character : source) {
+	for (size_t i = 0; i < source.size(); ++i) {
 		// The function itself is very similar to the match function. The differences are that we add own start state
 		// for each characetter to see if we may start matching here. Also we check for finite states during iteration
 		addState(_start_state, current_states);
+		auto byte_class = byteClass(source[i]);
 		std::unordered_set<std::shared_ptr<CState>> next_states;
 
 		// For each state check if it accepts the character. If so, move transition for the character into the intermediate states
 		for (const auto &state : current_states) {
-			if (state->transitions().count(character)) {
-				auto transition_state = state->transitions().at(character);
+			auto transition = state->transitions().find(byte_class);
+
+			if (transition != state->transitions().end()) {
+				const auto &transition_state = transition->second;
 
 				// Here we check if we get final state, which means we got a match.
 				// Here we reset states to initial to start new group matching
 				if (transition_state->isFinalState()) {
 					++result;
 
+					if (match_ends) {
+						match_ends->push_back(i + 1);
+					}
+
 					next_states.clear();
 					next_states.insert(_start_state);
 
@@ -106,6 +140,7 @@ int CNFA::countGroups(const std::string &source) const {
 		}
 
 		current_states = next_states;
+		PE_STATS(_stats->recordStep(current_states.size()));
 	}
 
 	return result;
@@ -116,6 +151,9 @@ int CNFA::count(const std::string &source) const {
 		throw std::invalid_argument("Empty string");
 	}
 
+	PE_STATS(CStatsTimer stats_timer(*_stats));
+	PE_STATS(_stats->bytes_scanned += source.size());
+
 	int result{ 0 };
 
 	// current_states contain intermediate states across all string parsing
@@ -126,12 +164,15 @@ int CNFA::count(const std::string &source) const {
 		// for each characetter to see if we may start matching here. Also we check for finite states during iteration.
 		// Note: we use multistates here to search for overlapping matches.
 		addMultistate(_start_state, current_states);
+		auto byte_class = byteClass(character);
 		std::vector<std::shared_ptr<CState>> next_states;
 
 		// For each state check if it accepts the character. If so, move transition for the character into the intermediate states
 		for (const auto &state : current_states) {
-			if (state->transitions().count(character)) {
-				auto transition_state = state->transitions().at(character);
+			auto transition = state->transitions().find(byte_class);
+
+			if (transition != state->transitions().end()) {
+				const auto &transition_state = transition->second;
 
 				addMultistate(transition_state, next_states);
 
@@ -143,12 +184,133 @@ int CNFA::count(const std::string &source) const {
 		}
 
 		current_states = next_states;
+		PE_STATS(_stats->recordStep(current_states.size()));
+	}
+
+	return result;
+}
+
+std::vector<std::shared_ptr<CState>> CNFA::states() const {
+	std::vector<std::shared_ptr<CState>> result{ _start_state };
+	std::unordered_set<std::shared_ptr<CState>> visited{ _start_state };
+
+	// Breadth-first traversal. `result` doubles as the queue
+	for (size_t i = 0; i < result.size(); ++i) {
+		auto state = result[i];
+
+		for (const auto &trans : state->transitions()) {
+			if (visited.insert(trans.second).second) {
+				result.push_back(trans.second);
+			}
+		}
+
+		for (const auto &eps : state->epsilonTransitions()) {
+			if (visited.insert(eps).second) {
+				result.push_back(eps);
+			}
+		}
 	}
 
 	return result;
 }
 
-std::string CNFA::toString() const {
-	std::unordered_set<size_t> set;
-	return _start_state->toString(set);
-}
\ No newline at end of file
+void CNFA::compressAlphabet() {
+	auto all_states = states();
+	std::unordered_map<CState *, uint32_t> indices;
+
+	for (const auto &state : all_states) {
+		indices.emplace(state.get(), static_cast<uint32_t>(indices.size()));
+	}
+
+	// Signature of a byte lists (source, target) state index pairs of all its transitions. States are visited in
+	// order and have a single transition per byte, so equal behaviour means equal signatures
+	std::vector<std::vector<std::pair<uint32_t, uint32_t>>> signatures(_byte_classes.size());
+
+	for (const auto &state : all_states) {
+		for (const auto &trans : state->transitions()) {
+			signatures[_byte_classes[trans.first]].emplace_back(indices.at(state.get()), indices.at(trans.second.get()));
+		}
+	}
+
+	// Bytes without transitions get class 0
+	std::map<std::vector<std::pair<uint32_t, uint32_t>>, CState::ByteClassType> classes;
+	CState::ByteClassesType byte_classes;
+
+	if (std::any_of(_byte_classes.begin(), _byte_classes.end(), [&signatures](CState::ByteClassType byte_class) { return signatures[byte_class].empty(); })) {
+		classes.emplace(std::vector<std::pair<uint32_t, uint32_t>>(), 0);
+	}
+
+	for (size_t byte = 0; byte < byte_classes.size(); ++byte) {
+		auto inserted = classes.emplace(signatures[_byte_classes[byte]], static_cast<CState::ByteClassType>(classes.size()));
+		byte_classes[byte] = inserted.first->second;
+	}
+
+	// Current transition keys are classes of the previous map
+	CState::ByteClassesType remap{};
+
+	for (size_t byte = 0; byte < byte_classes.size(); ++byte) {
+		remap[_byte_classes[byte]] = byte_classes[byte];
+	}
+
+	for (const auto &state : all_states) {
+		state->remapTransitions(remap);
+	}
+
+	_byte_classes = byte_classes;
+	_class_count = classes.size();
+}
+
+std::vector<unsigned char> CNFA::firstBytes() const {
+	std::vector<std::shared_ptr<CState>> stack{ _start_state };
+	std::unordered_set<std::shared_ptr<CState>> visited{ _start_state };
+	std::vector<bool> first_classes(_class_count, false);
+
+	// Depth-first over epsilon transitions of the start closure
+	while (!stack.empty()) {
+		auto state = stack.back();
+		stack.pop_back();
+
+		for (const auto &trans : state->transitions()) {
+			first_classes[trans.first] = true;
+		}
+
+		for (const auto &eps : state->epsilonTransitions()) {
+			if (visited.insert(eps).second) {
+				stack.push_back(eps);
+			}
+		}
+	}
+
+	std::vector<unsigned char> result;
+
+	for (size_t byte = 0; byte < _byte_classes.size(); ++byte) {
+		if (first_classes[_byte_classes[byte]]) {
+			result.push_back(static_cast<unsigned char>(byte));
+		}
+	}
+
+	return result;
+}
+
+std::string CNFA::toJson() const {
+	std::string result{ "{\"start\": " + std::to_string(_start_state->id()) + ", \"states\": [" };
+	const char *separator = "";
+
+	for (const auto &state : states()) {
+		result += separator + state->toJson();
+		separator = ", ";
+	}
+
+	result += "], \"class_count\": " + std::to_string(_class_count) + ", \"byte_classes\": [";
+	separator = "";
+
+	for (auto byte_class : _byte_classes) {
+		result += separator + std::to_string(byte_class);
+		separator = ", ";
+	}
+
+	result += "]";
+	PE_STATS(result += ", \"stats\": " + _stats->toJson());
+
+	return result + "}";
+}
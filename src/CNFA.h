@@ -1,6 +1,7 @@
 #pragma once
 
 #include "CState.h"
+#include "CStats.h"
 
 /**
  * @brief CNFA Non finite automata class for regular expressions
@@ -33,8 +34,9 @@ public:
 	* @brief count Counts unique pattern matches in the source string (`unique` means they don't overlap)
 	*
 	* @param source String to match
+	* @param match_ends If not null, receives offsets of match ends, exclusive
 	*/
-	int countGroups(const std::string &source) const;
+	int countGroups(const std::string &source, std::vector<size_t> *match_ends = nullptr) const;
 
 	/**
 	* @brief count Counts pattern matches in the source string. Returns total amount of matches which may overlap.
@@ -44,11 +46,76 @@ public:
 	int count(const std::string &source) const;
 
 	/**
-	 * @brief toString Stringify the NFA. For debug purposes
+	 * @brief states Collect all states reachable from the start state. The start state goes first
 	 *
-	 * @return Stringified state
+	 * @return NFA states
 	 */
-	std::string toString() const;
+	std::vector<std::shared_ptr<CState>> states() const;
+
+	/**
+	 * @brief toJson Machine-readable dump of the NFA graph and its runtime statistics, if enabled
+	 *
+	 * @return JSON object
+	 */
+	std::string toJson() const;
+
+	/**
+	 * @brief compressAlphabet Merge bytes which every state treats the same way into byte classes, and re-key
+	 *        state transitions by class. Engines then index their tables by class instead of by byte.
+	 *        Call once, after the NFA graph is complete
+	 */
+	void compressAlphabet();
+
+	/**
+	 * @brief byteClasses Byte to byte class map. Identity map until the alphabet is compressed
+	 */
+	const CState::ByteClassesType &byteClasses() const {
+		return _byte_classes;
+	}
+
+	/**
+	 * @brief classCount Amount of byte classes. Once the alphabet is compressed, bytes without any transitions
+	 *        are class 0
+	 */
+	size_t classCount() const {
+		return _class_count;
+	}
+
+	/**
+	 * @brief firstBytes Bytes with a transition out of the start state closure. A match starts with one of them
+	 *
+	 * @return Sorted bytes
+	 */
+	std::vector<unsigned char> firstBytes() const;
+
+	/**
+	 * @brief byteClass Class of the character
+	 */
+	CState::ByteClassType byteClass(char character) const {
+		return _byte_classes[static_cast<unsigned char>(character)];
+	}
+
+#ifdef PATTERN_ENGINE_STATS
+	/**
+	 * @brief stats Runtime statistics accessor. Statistics are shared between copies of the NFA
+	 *
+	 * @return Pattern statistics
+	 */
+	CStats &stats() const {
+		return *_stats;
+	}
+
+	/**
+	 * @brief detachStats Give this copy fresh statistics of its own, e.g. for a copy used by another thread.
+	 *        Engines built from the copy afterwards update them. Keeps the state count
+	 */
+	void detachStats() {
+		auto state_count = _stats->state_count;
+
+		_stats = std::make_shared<CStats>();
+		_stats->state_count = state_count;
+	}
+#endif
 
 	/**
 	 * @brief startState Start state accessor
@@ -74,8 +141,8 @@ private:
 	 * @param state State to add
 	 * @param state_set Set to add to
 	 */
-	static void addState(const std::shared_ptr<CState> &state,
-		                 std::unordered_set<std::shared_ptr<CState>> &state_set);
+	void addState(const std::shared_ptr<CState> &state,
+		          std::unordered_set<std::shared_ptr<CState>> &state_set) const;
 
 	/**
 	* @brief addMultistate Utility function. Add the state to the state vector. Doesn't check if the state is already added.
@@ -84,10 +151,15 @@ private:
 	* @param state State to add
 	* @param state_vector Vector to add to
 	*/
-	static void addMultistate(const std::shared_ptr<CState> &state,
-						      std::vector<std::shared_ptr<CState>> &state_vector);
+	void addMultistate(const std::shared_ptr<CState> &state,
+					   std::vector<std::shared_ptr<CState>> &state_vector) const;
 private:
 	std::shared_ptr<CState> _start_state;   ///< NFA start state
 	std::shared_ptr<CState> _final_state;   ///< NFA final state
+	CState::ByteClassesType _byte_classes;  ///< Byte to byte class map
+	size_t                  _class_count;   ///< Amount of byte classes
+#ifdef PATTERN_ENGINE_STATS
+	std::shared_ptr<CStats> _stats;         ///< Pattern runtime statistics
+#endif
 };
 
@@ -0,0 +1,44 @@
+#include "CPrefilter.h"
+
+#include <cstdint>
+
+CPrefilter::CPrefilter(const CNFA &nfa)
+	: _first_byte(-1)
+	, _second_byte(-1) {
+	auto first_bytes = nfa.firstBytes();
+
+	if (first_bytes.size() == 1 || first_bytes.size() == 2) {
+		_first_byte = first_bytes.front();
+		_second_byte = first_bytes.size() == 2 ? first_bytes.back() : -1;
+	}
+}
+
+size_t CPrefilter::findEither(const char *data, size_t position, size_t size) const {
+	const uint64_t ones = 0x0101010101010101ull;
+	const uint64_t highs = 0x8080808080808080ull;
+	const uint64_t first = ones * static_cast<uint64_t>(_first_byte);
+	const uint64_t second = ones * static_cast<uint64_t>(_second_byte);
+
+	// A byte of x is zero where the word holds the byte searched for. (x - ones) & ~x sets the high bit there
+	for (; position + sizeof(uint64_t) <= size; position += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, data + position, sizeof(word));
+
+		uint64_t x = word ^ first;
+		uint64_t y = word ^ second;
+
+		if (((x - ones) & ~x & highs) | ((y - ones) & ~y & highs)) {
+			break;
+		}
+	}
+
+	for (; position < size; ++position) {
+		auto byte = static_cast<unsigned char>(data[position]);
+
+		if (byte == _first_byte || byte == _second_byte) {
+			return position;
+		}
+	}
+
+	return size;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstring>
+
+#include "CNFA.h"
+
+/**
+ * @brief CPrefilter Search prefilter. While no match is in progress, skips right to the next byte which may start
+ *        a match. Applies when one byte (`memchr`) or two bytes (e.g. both cases of a letter) may start a match
+ */
+class CPrefilter
+{
+public:
+	/**
+	 * @brief CPrefilter Constructor. Analyzes bytes which may start a match
+	 *
+	 * @param nfa Compiled NFA
+	 */
+	explicit CPrefilter(const CNFA &nfa);
+
+	/**
+	 * @brief enabled Check if the prefilter applies to the pattern
+	 */
+	bool enabled() const {
+		return _first_byte >= 0;
+	}
+
+	/**
+	 * @brief find Find the next byte which may start a match. Requires `enabled`
+	 *
+	 * @param data Input start
+	 * @param position Search start
+	 * @param size Input size
+	 *
+	 * @return Position of the byte, `size` if there is none
+	 */
+	size_t find(const char *data, size_t position, size_t size) const {
+		if (_second_byte < 0) {
+			auto found = static_cast<const char *>(memchr(data + position, _first_byte, size - position));
+			return found ? static_cast<size_t>(found - data) : size;
+		}
+
+		return findEither(data, position, size);
+	}
+
+private:
+	/**
+	 * @brief findEither Find the next of two bytes, a word at a time
+	 *
+	 * @param data Input start
+	 * @param position Search start
+	 * @param size Input size
+	 *
+	 * @return Position of the byte, `size` if there is none
+	 */
+	size_t findEither(const char *data, size_t position, size_t size) const;
+
+	int _first_byte;  ///< The only byte which may start a match, or -1
+	int _second_byte; ///< The other byte if two bytes may start a match, or -1
+};
@@ -1,15 +1,30 @@
 #include "CRegex.h"
 
+#include <cctype>
+
 CRegex::CRegex()
-	: _state_count(0) {}
+	: _state_count(0)
+	, _flags(NO_FLAGS) {}
 
-CNFA CRegex::compile(std::string regex) {
+CMatcher CRegex::compile(std::string regex, int flags) {
 	if (!regex.size()) {
 		throw std::invalid_argument("Empty regex");
 	}
 
+	_flags = flags;
+
 	auto begin = regex.begin();
-	return compileIter(begin, regex.end());
+	auto nfa = compileIter(begin, regex.end());
+
+	if (!(flags & NO_ALPHABET_COMPRESSION)) {
+		nfa.compressAlphabet();
+	}
+	PE_STATS(nfa.stats().state_count = nfa.states().size());
+
+	// Literal search compares bytes, so case insensitive patterns go to the automata
+	bool is_literal = !(flags & CASE_INSENSITIVE) && regex.find_first_of("()|*+?") == std::string::npos;
+
+	return CMatcher(nfa, is_literal ? regex : std::string());
 }
 
 CNFA CRegex::compileIter(std::string::iterator &begin, const std::string::iterator &end) {
@@ -85,7 +100,15 @@ void CRegex::handleChar(char character, std::stack<CNFA> &nfas) {
 	auto start_state = makeState();
 	auto end_state = makeState();
 
-	start_state->addTransition(character, end_state);
+	auto byte = static_cast<unsigned char>(character);
+
+	if (_flags & CASE_INSENSITIVE && byte < 0x80 && std::isalpha(byte)) {
+		start_state->addTransition(static_cast<CState::ByteClassType>(std::tolower(byte)), end_state);
+		start_state->addTransition(static_cast<CState::ByteClassType>(std::toupper(byte)), end_state);
+	}
+	else {
+		start_state->addTransition(byte, end_state);
+	}
 
 	nfas.push(CNFA(start_state, end_state));
 }
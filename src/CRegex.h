@@ -2,7 +2,7 @@
 
 #include <stack>
 
-#include "CNFA.h"
+#include "CMatcher.h"
 
 /**
  * @brief CRegex Regular expression type. Preforms regex compilation. Supports:
@@ -16,6 +16,15 @@
 class CRegex
 {
 public:
+	/**
+	 * @brief Flags Compilation flags
+	 */
+	enum Flags {
+		NO_FLAGS                = 0,      ///< Default compilation
+		CASE_INSENSITIVE        = 1 << 0, ///< ASCII letters match regardless of their case
+		NO_ALPHABET_COMPRESSION = 1 << 1, ///< Keep a transition key per byte. Reference for testing byte classes
+	};
+
 	CRegex();
 
 	/**
@@ -23,11 +32,13 @@ public:
 	 *        Thompson's construction.
 	 *
 	 * @param regex Regular expression string
+	 * @param flags Combination of `Flags`
 	 *
-	 * @return NFA which performs matches
+	 * @return Matcher which selects the matching engine for the pattern. Not thread-safe: it caches DFA states
+	 *         while matching, so every thread needs its own copy
 	 * @throws std::invalid_argument exception if invalid pattern
 	 */
-	CNFA compile(std::string regex);
+	CMatcher compile(std::string regex, int flags = NO_FLAGS);
 
 private:
 	/**
@@ -53,7 +64,8 @@ private:
 	void concat(std::stack<CNFA> &nfas);
 
 	/**
-	 * @brief handleChar Handles character in a regex. Creates NFA with transition from top state to a new state
+	 * @brief handleChar Handles character in a regex. Creates NFA with transition from top state to a new state.
+	 *        Case insensitive letters get a transition for both cases
 	 *
 	 * @param character Character for transition
 	 * @param nfas NFA stack for current group
@@ -85,5 +97,6 @@ private:
 
 private:
 	size_t _state_count; ///< Consequent state counter to name states
+	int    _flags;       ///< Flags of the pattern being compiled
 };
 
@@ -23,16 +23,30 @@ void CState::deinit() {
 	}
 }
 
-void CState::addTransition(const char character, std::shared_ptr<CState> state) {
+void CState::addTransition(const ByteClassType byte_class, std::shared_ptr<CState> state) {
 	if (!state) {
 		throw std::invalid_argument("Empty epsilon transition state");
 	}
 
-	if (_transitions.count(character)) {
+	if (_transitions.count(byte_class)) {
 		throw std::invalid_argument("State already contains transition for the character");
 	}
 
-	_transitions[character] = state;
+	_transitions[byte_class] = state;
+}
+
+void CState::remapTransitions(const ByteClassesType &byte_classes) {
+	TransitionsType transitions;
+
+	for (const auto &trans : _transitions) {
+		auto inserted = transitions.emplace(byte_classes[trans.first], trans.second);
+
+		if (!inserted.second && inserted.first->second != trans.second) {
+			throw std::invalid_argument("Bytes of a class lead into different states");
+		}
+	}
+
+	_transitions.swap(transitions);
 }
 
 void CState::addEpsilonTransition(std::shared_ptr<CState> state) {
@@ -44,27 +58,22 @@ void CState::addEpsilonTransition(std::shared_ptr<CState> state) {
 	_epsilons.push_back(state);
 }
 
-std::string CState::toString(std::unordered_set<size_t> &visited) {
-	std::string name = "s:" + std::to_string(_id);
-
-	if (visited.count(_id)) {
-		return name;
-	}
-
-	visited.insert(_id);
-
-	std::string result{ "((<" + name + ">: { " };
+std::string CState::toJson() const {
+	std::string result{ "{\"id\": " + std::to_string(_id) + ", \"final\": " + (_is_final_state ? "true" : "false") + ", \"transitions\": {" };
+	const char *separator = "";
 
 	for (const auto &trans : _transitions) {
-		result += "'" + std::string(1, trans.first) + "': " + trans.second->toString(visited) + ", ";
+		result += separator + ("\"" + std::to_string(trans.first) + "\": " + std::to_string(trans.second->_id));
+		separator = ", ";
 	}
 
-	result += " }, [ ";
+	result += "}, \"epsilons\": [";
+	separator = "";
 
 	for (const auto &eps : _epsilons) {
-		result += eps->toString(visited) + ", ";
+		result += separator + std::to_string(eps->_id);
+		separator = ", ";
 	}
 
-	result += " ], " + std::to_string(_is_final_state) + "))";
-	return result;
+	return result + "]}";
 }
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include <unordered_set>
 #include <memory>
+#include <stdexcept>
 
 /**
  * @brief CState A single state of automata
@@ -18,9 +21,20 @@ public:
 	using EpsilonTransitionsType = std::vector<std::shared_ptr<CState>>;
 
 	/**
-	* @brief TransitionsType Type of transitions map
+	 * @brief ByteClassType Byte class. Bytes of a class are indistinguishable for the pattern
+	 */
+	using ByteClassType = uint8_t;
+
+	/**
+	 * @brief ByteClassesType Byte to byte class map
+	 */
+	using ByteClassesType = std::array<ByteClassType, 256>;
+
+	/**
+	* @brief TransitionsType Type of transitions map. Keys are byte classes. Until the alphabet is compressed
+	*        every byte is a class of its own
 	*/
-	using TransitionsType = std::unordered_map<char, std::shared_ptr<CState>>;
+	using TransitionsType = std::unordered_map<ByteClassType, std::shared_ptr<CState>>;
 
 	/**
 	 * @brief CState Constructor
@@ -39,6 +53,13 @@ public:
 	 */
 	void deinit();
 
+	/**
+	 * @brief id State ID accessor
+	 */
+	size_t id() const {
+		return _id;
+	}
+
 	/**
 	 * @brief isFinalState Check if the is a final state
 	 *
@@ -58,17 +79,24 @@ public:
 	}
 
 	/**
-	 * @brief addTransition Add transition from state for the character
+	 * @brief addTransition Add transition from state for the byte class
 	 *
-	 * @param character Character for transition
+	 * @param byte_class Byte class for transition
 	 * @param state State to transit into
 	 */
-	void addTransition(const char character, std::shared_ptr<CState> state);
+	void addTransition(const ByteClassType byte_class, std::shared_ptr<CState> state);
+
+	/**
+	 * @brief remapTransitions Re-key transitions by byte classes. Bytes of a class must lead into the same state
+	 *
+	 * @param byte_classes Class of every current transition key
+	 */
+	void remapTransitions(const ByteClassesType &byte_classes);
 
 	/**
 	 * @brief transitions Get state transitions
 	 */
-	const TransitionsType transitions() const {
+	const TransitionsType &transitions() const {
 		return _transitions;
 	}
 
@@ -82,19 +110,16 @@ public:
 	/**
 	* @brief transitions Get state epsilon transitions
 	*/
-	const EpsilonTransitionsType epsilonTransitions() const {
+	const EpsilonTransitionsType &epsilonTransitions() const {
 		return _epsilons;
 	}
 
 	/**
-	* @brief toString Stringifies the state for debug purposes
-	*
-	* @param visited A set of already printed states. If the state is in the set it just returns own name,
-	*        otherwise prints all transitions, epsilons and final state flag
+	* @brief toJson Machine-readable dump of the state. Referenced states are written as IDs
 	*
-	* @return Stringified state
+	* @return JSON object
 	*/
-	std::string toString(std::unordered_set<std::size_t> &visited);
+	std::string toJson() const;
 
 private:
 	EpsilonTransitionsType _epsilons;       ///< State Epsilon transitions
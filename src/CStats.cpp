@@ -0,0 +1,34 @@
+#include "CStats.h"
+
+#include <algorithm>
+
+void CStats::merge(const CStats &other) {
+	state_count = std::max(state_count, other.state_count);
+	calls += other.calls;
+	steps += other.steps;
+	active_states_max = std::max(active_states_max, other.active_states_max);
+	active_states_total += other.active_states_total;
+	epsilon_closure_work += other.epsilon_closure_work;
+	bytes_scanned += other.bytes_scanned;
+	bytes_skipped += other.bytes_skipped;
+	dfa_cache_hits += other.dfa_cache_hits;
+	dfa_cache_misses += other.dfa_cache_misses;
+	dfa_cache_flushes += other.dfa_cache_flushes;
+	time_ns += other.time_ns;
+}
+
+std::string CStats::toJson() const {
+	return "{\"calls\": " + std::to_string(calls)
+		+ ", \"state_count\": " + std::to_string(state_count)
+		+ ", \"steps\": " + std::to_string(steps)
+		+ ", \"active_states_max\": " + std::to_string(active_states_max)
+		+ ", \"active_states_avg\": " + std::to_string(activeStatesAverage())
+		+ ", \"epsilon_closure_work\": " + std::to_string(epsilon_closure_work)
+		+ ", \"bytes_scanned\": " + std::to_string(bytes_scanned)
+		+ ", \"bytes_skipped\": " + std::to_string(bytes_skipped)
+		+ ", \"dfa_cache_hits\": " + std::to_string(dfa_cache_hits)
+		+ ", \"dfa_cache_misses\": " + std::to_string(dfa_cache_misses)
+		+ ", \"dfa_cache_flushes\": " + std::to_string(dfa_cache_flushes)
+		+ ", \"time_ns\": " + std::to_string(time_ns)
+		+ "}";
+}
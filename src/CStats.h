@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief PE_STATS Instrumentation hook. Runtime statistics are opt-in: define PATTERN_ENGINE_STATS to collect them,
+ *        otherwise every hook compiles out
+ */
+#ifdef PATTERN_ENGINE_STATS
+#define PE_STATS(...) __VA_ARGS__
+#else
+#define PE_STATS(...)
+#endif
+
+/**
+ * @brief CStats Runtime statistics of a single compiled pattern. Not thread-safe
+ */
+struct CStats
+{
+	size_t   state_count{ 0 };          ///< NFA state count
+	size_t   calls{ 0 };                ///< Matching calls
+	size_t   steps{ 0 };                ///< Characters fed into the automaton
+	size_t   active_states_max{ 0 };    ///< Maximum active set size after a step
+	size_t   active_states_total{ 0 };  ///< Sum of active set sizes after each step
+	size_t   epsilon_closure_work{ 0 }; ///< States visited while computing epsilon closures
+	size_t   bytes_scanned{ 0 };        ///< Source bytes processed
+	size_t   bytes_skipped{ 0 };        ///< Source bytes skipped by search prefilters
+	size_t   dfa_cache_hits{ 0 };       ///< DFA transitions found in the cache
+	size_t   dfa_cache_misses{ 0 };     ///< DFA transitions computed
+	size_t   dfa_cache_flushes{ 0 };    ///< DFA cache flushes
+	uint64_t time_ns{ 0 };              ///< Time spent in matching calls
+
+	/**
+	 * @brief recordStep Record active set size after a single character step
+	 *
+	 * @param active_states Active set size
+	 */
+	void recordStep(size_t active_states) {
+		++steps;
+		active_states_total += active_states;
+
+		if (active_states > active_states_max) {
+			active_states_max = active_states;
+		}
+	}
+
+	/**
+	 * @brief activeStatesAverage Average active set size per step
+	 */
+	double activeStatesAverage() const {
+		return steps ? static_cast<double>(active_states_total) / steps : 0.0;
+	}
+
+	/**
+	 * @brief merge Add statistics collected by another copy of the pattern, e.g. in another thread
+	 *
+	 * @param other Statistics to add
+	 */
+	void merge(const CStats &other);
+
+	/**
+	 * @brief toJson Machine-readable dump of the statistics
+	 *
+	 * @return JSON object
+	 */
+	std::string toJson() const;
+};
+
+/**
+ * @brief CStatsTimer Scoped timer. Counts a matching call and adds its duration to the statistics
+ */
+class CStatsTimer
+{
+public:
+	explicit CStatsTimer(CStats &stats)
+		: _stats(stats)
+		, _started(std::chrono::steady_clock::now()) {
+		++_stats.calls;
+	}
+
+	~CStatsTimer() {
+		auto elapsed = std::chrono::steady_clock::now() - _started;
+		_stats.time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	}
+
+	CStatsTimer(const CStatsTimer &) = delete;
+	CStatsTimer &operator=(const CStatsTimer &) = delete;
+
+private:
+	CStats                                &_stats;   ///< Statistics to update
+	std::chrono::steady_clock::time_point  _started; ///< Call start time
+};